@@ -38,11 +38,17 @@ using std::string;
 #include <vector>
 using std::vector;
 
+#include <sparrowhawk/normalize_stats.h>
 #include <sparrowhawk/normalizer.h>
+#include <sparrowhawk/streaming_normalizer.h>
 
 DEFINE_bool(multi_line_text, false, "Text is spread across multiple lines.");
 DEFINE_string(config, "", "Path to the configuration proto.");
 DEFINE_string(path_prefix, "./", "Optional path prefix if not relative.");
+DEFINE_bool(print_stats, false,
+            "Print the totals of the normalization stats to stderr at exit.");
+DEFINE_bool(save_grammar_cache, false,
+            "Write the grammar caches next to the grammar fars and exit.");
 
 void NormalizeInput(const string& input,
                     speech::sparrowhawk::Normalizer *normalizer) {
@@ -61,18 +67,35 @@ int main(int argc, char** argv) {
   std::unique_ptr<Normalizer> normalizer;
   normalizer.reset(new Normalizer());
   CHECK(normalizer->Setup(FLAGS_config, FLAGS_path_prefix));
+  if (FLAGS_save_grammar_cache) {
+    CHECK(normalizer->SaveGrammarCaches());
+    return 0;
+  }
+  if (FLAGS_print_stats) {
+    speech::sparrowhawk::SetGlobalNormalizeStatsEnabled(true);
+  }
   string input;
   if (FLAGS_multi_line_text) {
+    // Sentences may run across lines, so the lines are joined with spaces, and
+    // each sentence is output as soon as it is complete.
+    speech::sparrowhawk::StreamingNormalizer streaming_normalizer(
+        normalizer->model(),
+        [](const string &output) { std::cout << output << std::endl; });
+    bool first_line = true;
     string line;
     while (std::getline(std::cin, line)) {
-      if (!input.empty()) input += " ";
-      input += line;
+      if (!first_line) streaming_normalizer.Feed(" ");
+      streaming_normalizer.Feed(line);
+      first_line = false;
     }
-    NormalizeInput(input, normalizer.get());
+    streaming_normalizer.Flush();
   } else {
     while (std::getline(std::cin, input)) {
       NormalizeInput(input, normalizer.get());
     }
   }
+  if (FLAGS_print_stats) {
+    std::cerr << speech::sparrowhawk::GetGlobalNormalizeStats().ToString();
+  }
   return 0;
 }
@@ -0,0 +1,68 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// Extraction of the best path of a lattice as a sequence of label pairs, which
+// is what ProtobufParser consumes.
+//
+// BestPath() reads the lattice in a single depth-first pass, so it can be given
+// a delayed FST such as the ComposeFst of the last rule of a cascade, and
+// neither the lattice nor its shortest path is ever built as a VectorFst.
+
+#ifndef SPARROWHAWK_BEST_PATH_H_
+#define SPARROWHAWK_BEST_PATH_H_
+
+#include <utility>
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+#include <fst/fstlib.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+// Input and output labels of the arcs along a path.
+typedef std::vector<std::pair<fst::StdArc::Label, fst::StdArc::Label>>
+    LabelPath;
+
+// Finds the lowest-cost successful path of fst and stores its labels in path,
+// leaving out arcs that are epsilon on both sides. Lattices with cycles, which
+// the single pass cannot handle, are copied with CopyWithinLimits() and passed
+// to fst::ShortestPath() instead. If num_states and num_arcs are not null,
+// they are set to the number of states and arcs of fst that were visited.
+// Returns false if fst has no successful path, or if the search visits more
+// than max_states states or max_arcs arcs, where 0 means no limit.
+bool BestPath(const fst::Fst<fst::StdArc> &fst,
+              int64 max_states,
+              int64 max_arcs,
+              LabelPath *path,
+              int64 *num_states = nullptr,
+              int64 *num_arcs = nullptr);
+
+// Copies the states of fst reachable from its start to output one at a time,
+// so that a delayed fst is expanded no further than the limits, where 0 means
+// no limit. Returns false if fst has more than max_states states or max_arcs
+// arcs.
+bool CopyWithinLimits(const fst::Fst<fst::StdArc> &fst,
+                      int64 max_states,
+                      int64 max_arcs,
+                      fst::MutableFst<fst::StdArc> *output);
+
+// Stores the labels of the path of an FST that has a single path, such as the
+// output of fst::ShortestPath(), following the first arc out of each state.
+void GetPathLabels(const fst::Fst<fst::StdArc> &fst, LabelPath *path);
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_BEST_PATH_H_
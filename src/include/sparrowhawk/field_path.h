@@ -53,6 +53,11 @@ class FieldPath {
   // Number of fields on this path. Does not count the root as a field.
   inline int GetLength() const { return path_.size(); }
 
+  // The index-th field on this path, counting from the root.
+  inline const google::protobuf::FieldDescriptor *GetField(int index) const {
+    return path_[index];
+  }
+
   // True if GetLength() == 0.
   inline bool IsEmpty() const { return GetLength() == 0; }
 
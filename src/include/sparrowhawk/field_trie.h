@@ -0,0 +1,111 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// The field paths of a serialization spec, compiled into a trie of the
+// intermediate messages they go through, so that paths with a common prefix,
+// such as money.amount.integer_part and money.amount.fractional_part, share
+// the lookups of its messages.
+//
+// The trie is built once with the spec, and each token is then read through a
+// FieldTrie::Messages, which resolves each intermediate message the first time
+// it is asked for and keeps it for every later path under it.
+
+#ifndef SPARROWHAWK_FIELD_TRIE_H_
+#define SPARROWHAWK_FIELD_TRIE_H_
+
+#include <map>
+#include <string>
+using std::string;
+#include <utility>
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <sparrowhawk/message_fields.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+class FieldTrie {
+ public:
+  typedef google::protobuf::Descriptor Descriptor;
+  typedef google::protobuf::FieldDescriptor FieldDescriptor;
+  typedef google::protobuf::Message Message;
+
+  // The field at the end of a path, and the trie node of the message it is a
+  // field of.
+  struct Field {
+    int parent;
+    const FieldDescriptor *descriptor;
+  };
+
+  // The root node, for messages of root_type.
+  static const int kRoot = 0;
+
+  explicit FieldTrie(const Descriptor *root_type);
+
+  // Parses path_string as FieldPath::Parse() does, adding its intermediate
+  // messages to the trie, and sets field to its terminal field. Returns false
+  // if the path does not parse.
+  bool AddPath(const string &path_string, Field *field);
+
+  const Descriptor *root_type() const { return root_type_; }
+
+  // The messages of the trie within one root message.
+  class Messages {
+   public:
+    // root must be of the root type of trie, and both must outlive this.
+    Messages(const FieldTrie &trie, const Message &root);
+
+    // Returns the message of node. All the intermediate messages are assumed
+    // to be non-repeated.
+    const Message &Get(int node);
+
+    // Returns true if field is set, or for a repeated field, has any values.
+    bool IsSet(const Field &field);
+
+    // Returns the number of values of a repeated field.
+    int FieldSize(const Field &field);
+
+   private:
+    const FieldTrie &trie_;
+    // Indexed by node, and null until resolved.
+    std::vector<const Message *> messages_;
+
+    DISALLOW_COPY_AND_ASSIGN(Messages);
+  };
+
+ private:
+  // An intermediate message, as a field of the message of its parent node.
+  struct Node {
+    int parent;
+    const FieldDescriptor *field;
+    // The generated accessors of the message's type, or null to use
+    // reflection.
+    const MessageFields *fields;
+  };
+
+  const Descriptor *root_type_;
+  // Indexed by node. A node's parent always comes before it.
+  std::vector<Node> nodes_;
+  std::map<std::pair<int, const FieldDescriptor *>, int> children_;
+
+  DISALLOW_COPY_AND_ASSIGN(FieldTrie);
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_FIELD_TRIE_H_
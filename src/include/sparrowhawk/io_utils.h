@@ -25,6 +25,14 @@ namespace sparrowhawk {
 class IOStream {
  public:
   static string LoadFileToString(const string &filename);
+
+  // Computes a 64-bit fingerprint of the contents of filename, suitable for
+  // telling whether a file has changed. Returns false if it cannot be read.
+  static bool FingerprintFile(const string &filename, uint64 *fingerprint);
+
+  // Gets the size and last modification time of filename without reading it.
+  // Returns false if the file cannot be found.
+  static bool StatFile(const string &filename, int64 *size, int64 *mtime);
 };
 
 }  // namespace sparrowhawk
@@ -0,0 +1,15 @@
+// Generated by protoc-gen-sparrowhawk from items.proto. DO NOT EDIT.
+
+#ifndef SPARROWHAWK_ITEMS_FIELDS_H_
+#define SPARROWHAWK_ITEMS_FIELDS_H_
+
+namespace speech {
+namespace sparrowhawk {
+
+// Registers the MessageFields of the message types in items.proto.
+void RegisterItemsMessageFields();
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_ITEMS_FIELDS_H_
@@ -0,0 +1,148 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// A thread-safe least-recently-used cache from strings to values.
+//
+// Each entry has a charge, such as its size in bytes or simply 1, and the
+// least recently used entries are evicted whenever the total charge goes over
+// the capacity. The keys are spread over a number of shards, each with its own
+// lock and its own share of the capacity, so that threads working on
+// different keys rarely contend.
+
+#ifndef SPARROWHAWK_LRU_CACHE_H_
+#define SPARROWHAWK_LRU_CACHE_H_
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+using std::string;
+#include <unordered_map>
+#include <utility>
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+template <class Value>
+class LruCache {
+ public:
+  static const int kDefaultNumShards = 16;
+
+  explicit LruCache(size_t capacity, int num_shards = kDefaultNumShards)
+      : shards_(num_shards), hits_(0), misses_(0) {
+    for (auto &shard : shards_) {
+      shard.reset(new Shard);
+      shard->capacity = (capacity + num_shards - 1) / num_shards;
+      shard->usage = 0;
+    }
+  }
+
+  // Copies the value cached for key to value, marking it as the most recently
+  // used entry. Returns false if key is not in the cache.
+  bool Lookup(const string &key, Value *value) {
+    Shard *shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->index.find(key);
+    if (it == shard->index.end()) {
+      ++misses_;
+      return false;
+    }
+    shard->entries.splice(shard->entries.begin(), shard->entries, it->second);
+    *value = it->second->value;
+    ++hits_;
+    return true;
+  }
+
+  // Caches value for key, replacing any previous value, and evicts entries
+  // until the shard is within its capacity again. An entry whose charge alone
+  // exceeds the capacity of a shard is not cached at all.
+  void Insert(const string &key, const Value &value, size_t charge) {
+    Shard *shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->index.find(key);
+    if (it != shard->index.end()) Erase(shard, it);
+    if (charge > shard->capacity) return;
+    shard->entries.push_front(Entry(key, value, charge));
+    shard->index[key] = shard->entries.begin();
+    shard->usage += charge;
+    while (shard->usage > shard->capacity) {
+      Erase(shard, shard->index.find(shard->entries.back().key));
+    }
+  }
+
+  // Removes all the entries. The hit and miss counts are kept.
+  void Clear() {
+    for (auto &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      shard->index.clear();
+      shard->entries.clear();
+      shard->usage = 0;
+    }
+  }
+
+  // Number of Lookup() calls that found, or did not find, their key.
+  int64 hits() const { return hits_; }
+  int64 misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    Entry(const string &key, const Value &value, size_t charge)
+        : key(key), value(value), charge(charge) { }
+
+    string key;
+    Value value;
+    size_t charge;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  struct Shard {
+    std::mutex mutex;
+    // Most recently used first.
+    EntryList entries;
+    std::unordered_map<string, typename EntryList::iterator> index;
+    size_t capacity;
+    size_t usage;
+  };
+
+  Shard *ShardFor(const string &key) {
+    return shards_[std::hash<string>()(key) % shards_.size()].get();
+  }
+
+  // Requires the lock of shard to be held.
+  static void Erase(
+      Shard *shard,
+      typename std::unordered_map<string,
+                                  typename EntryList::iterator>::iterator it) {
+    shard->usage -= it->second->charge;
+    shard->entries.erase(it->second);
+    shard->index.erase(it);
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<int64> hits_;
+  std::atomic<int64> misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(LruCache);
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_LRU_CACHE_H_
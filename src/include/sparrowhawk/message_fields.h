@@ -0,0 +1,133 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// Reflection-free access to the fields of a message type, for ProtobufParser
+// and ProtobufSerializer.
+//
+// The implementations are generated by protoc-gen-sparrowhawk (see
+// src/proto/protoc_gen_sparrowhawk.cc) for the message types in items.proto and
+// semiotic_classes.proto, and call the generated accessors directly instead of
+// going through google::protobuf::Reflection. Message types without one are
+// still handled with reflection, and so are extension fields: the methods below
+// fall back to reflection for them, except where noted.
+
+#ifndef SPARROWHAWK_MESSAGE_FIELDS_H_
+#define SPARROWHAWK_MESSAGE_FIELDS_H_
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+class MessageFields {
+ public:
+  typedef google::protobuf::FieldDescriptor FieldDescriptor;
+  typedef google::protobuf::Message Message;
+
+  virtual ~MessageFields() { }
+
+  // Returns the field called name, or NULL if there is none.
+  virtual const FieldDescriptor *FindFieldByName(const string &name) const = 0;
+
+  // Adds the fields of message that are set to fields, in field number order,
+  // as Reflection::ListFields() does.
+  virtual void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const = 0;
+
+  // Returns the number of values of a repeated field.
+  virtual int FieldSize(const Message &message,
+                        const FieldDescriptor *field) const = 0;
+
+  // Returns the value of a message field, or the index-th value if it is
+  // repeated. The index is ignored for singular fields.
+  virtual const Message &GetMessage(const Message &message,
+                                    const FieldDescriptor *field,
+                                    int index) const = 0;
+
+  // As above, for string and bytes fields. Like
+  // Reflection::GetStringReference(), it may return scratch instead.
+  virtual const string &GetString(const Message &message,
+                                  const FieldDescriptor *field,
+                                  int index,
+                                  string *scratch) const = 0;
+
+  // Appends the text form of a bool, integer or enum value to text. Returns
+  // false for other types of field, and for extensions.
+  virtual bool AppendValue(const Message &message,
+                           const FieldDescriptor *field,
+                           int index,
+                           string *text) const = 0;
+
+  // Returns the message field for setting, adding a new value if the field is
+  // repeated.
+  virtual Message *MutableMessage(Message *message,
+                                  const FieldDescriptor *field) const = 0;
+
+  // Sets a field other than a message field from its text form, adding a new
+  // value if the field is repeated. A value that cannot be converted is
+  // logged and left unset. Returns false, without doing anything, for
+  // extensions.
+  virtual bool SetFieldFromString(Message *message,
+                                  const FieldDescriptor *field,
+                                  const string &value) const = 0;
+};
+
+// Returns the generated MessageFields of a message type, or NULL if it has
+// none.
+const MessageFields *FindMessageFields(
+    const google::protobuf::Descriptor *descriptor);
+
+// Used by the generated code.
+
+// Makes fields the MessageFields of descriptor.
+void RegisterMessageFields(const google::protobuf::Descriptor *descriptor,
+                           const MessageFields *fields);
+
+// A field name and its FieldDescriptor::index().
+struct FieldName {
+  const char *name;
+  int index;
+};
+
+// Returns the index of the field called name among the num_names names, which
+// are sorted, or -1 if there is none.
+int FindFieldIndex(const FieldName *names, int num_names, const string &name);
+
+// Convert the text form of a value, logging an error on failure.
+bool ParseFieldValue(const string &text, bool *value);
+bool ParseFieldValue(const string &text, int32 *value);
+bool ParseFieldValue(const string &text, int64 *value);
+bool ParseFieldValue(const string &text, uint32 *value);
+bool ParseFieldValue(const string &text, uint64 *value);
+bool ParseFieldValue(const string &text, float *value);
+bool ParseFieldValue(const string &text, double *value);
+
+// Appends the text form of a value, as TextFormat prints it.
+void AppendFieldValue(bool value, string *text);
+void AppendFieldValue(int32 value, string *text);
+void AppendFieldValue(int64 value, string *text);
+void AppendFieldValue(uint32 value, string *text);
+void AppendFieldValue(uint64 value, string *text);
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_MESSAGE_FIELDS_H_
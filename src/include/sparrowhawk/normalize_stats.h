@@ -0,0 +1,119 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// Timings and sizes of the stages of normalization, for finding slow inputs
+// and grammar regressions.
+//
+// A caller can ask for the stats of a single Normalize() call, and the stats
+// of every call can also be added up into process-wide totals, which are off
+// by default.
+
+#ifndef SPARROWHAWK_NORMALIZE_STATS_H_
+#define SPARROWHAWK_NORMALIZE_STATS_H_
+
+#include <chrono>
+#include <map>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+struct NormalizeStats {
+  NormalizeStats() { Clear(); }
+
+  void Clear();
+
+  // Adds the counts and times of other to these. The per-call verbalizer times
+  // are appended.
+  void Add(const NormalizeStats &other);
+
+  // Returns the stats as lines of "name<tab>value".
+  string ToString() const;
+
+  // Number of sentences normalized, and how many of them came from the
+  // sentence cache.
+  int64 num_sentences;
+  int64 num_sentence_cache_hits;
+
+  // Wall times of the stages, in microseconds. The tokenizer time includes
+  // compiling the input string and finding the best path of its output. The
+  // serialization and verbalizer times are summed over all the tokens.
+  int64 tokenizer_usec;
+  int64 parse_usec;
+  int64 serialization_usec;
+  int64 verbalizer_usec;
+
+  int64 num_verbalizer_calls;
+  // Wall time of each verbalizer call, in token order.
+  std::vector<int64> verbalizer_call_usec;
+
+  // Size of the part of the tokenizer output lattice that was searched for
+  // its best path, and the number of arcs on that path.
+  int64 tokenizer_output_states;
+  int64 tokenizer_output_arcs;
+  int64 best_path_length;
+
+  // Number of tokens of each type, with semiotic classes counted by the name of
+  // the class, such as "cardinal".
+  std::map<string, int64> tokens_per_class;
+
+  int64 num_verbalization_cache_hits;
+  // Number of semiotic classes that failed to verbalize and were read
+  // verbatim instead.
+  int64 num_verbatim_fallbacks;
+};
+
+// Adds the elapsed wall time of its scope to a counter. A null counter turns
+// it off.
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(int64 *usec) : usec_(usec) {
+    if (usec_ != nullptr) start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedStageTimer() {
+    if (usec_ == nullptr) return;
+    *usec_ += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  int64 *usec_;
+  std::chrono::steady_clock::time_point start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedStageTimer);
+};
+
+// Turns on or off adding the stats of every normalization to the process-wide
+// totals.
+void SetGlobalNormalizeStatsEnabled(bool enabled);
+
+bool GlobalNormalizeStatsEnabled();
+
+// Adds stats to the process-wide totals. Thread safe.
+void AddToGlobalNormalizeStats(const NormalizeStats &stats);
+
+// Returns the process-wide totals, without the per-call verbalizer times.
+NormalizeStats GetGlobalNormalizeStats();
+
+void ResetGlobalNormalizeStats();
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_NORMALIZE_STATS_H_
@@ -22,10 +22,23 @@
 // normalizer. The system can output as an unannotated string of words, and
 // richer annotation with links between input tokens, their input string
 // positions, and the output words is also available.
+//
+// The Normalizer is a convenience wrapper around a NormalizerModel
+// (normalizer_model.h), which holds the loaded grammars, and the
+// NormalizerSessions (normalizer_session.h) that run the pipeline. Once Setup()
+// has returned, all the const methods of a Normalizer may be called
+// concurrently from many threads, so a single loaded instance can be shared by
+// all of them. Normalize() and NormalizeAndShowLinks() reuse one session that
+// Setup() creates, and only a call made while another thread is using it pays
+// for a session of its own. Callers that normalize many sentences on several
+// threads can instead create one session per thread from model().
 
 #ifndef SPARROWHAWK_NORMALIZER_H_
 #define SPARROWHAWK_NORMALIZER_H_
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 using std::string;
 #include <vector>
@@ -33,115 +46,97 @@ using std::vector;
 
 #include <fst/compat.h>
 #include <sparrowhawk/items.pb.h>
-#include <sparrowhawk/sentence_boundary.h>
-#include <sparrowhawk/sparrowhawk_configuration.pb.h>
-#include <sparrowhawk/rule_system.h>
-#include <sparrowhawk/spec_serializer.h>
+#include <sparrowhawk/normalize_stats.h>
+#include <sparrowhawk/normalizer_model.h>
+#include <sparrowhawk/thread_pool.h>
 
 namespace speech {
 namespace sparrowhawk {
 
+class NormalizerSession;
+
 class Normalizer {
  public:
   Normalizer();
 
   ~Normalizer();
 
-  // The functions definitions have been split across two files, normalizer.cc
-  // and normalizer_utils.cc, just to keep things a littler tidier. Below we
-  // indicate where each function is found.
-
-  // normalizer.cc
   // Method to load and set data for each derived method
   bool Setup(const string &configuration_proto, const string &pathname_prefix);
 
-  // normalizer.cc
+  // Brings the normalizer up to its steady-state speed: pages in all of the
+  // grammars and normalizes a few sample sentences, so that the one-off costs
+  // are not paid by the first real request. Servers should call this before
+  // reporting themselves ready. Returns false if Setup() has not succeeded.
+  bool Warmup() const;
+
+  // Saves the transducers prepared by Setup() next to the grammar fars, so that
+  // later Setup() calls with the same grammars can read or map them instead of
+  // building them again. Typically run once when the grammars are deployed.
+  // Returns false if Setup() has not succeeded or a cache cannot be written.
+  bool SaveGrammarCaches() const;
+
+  // Empties the verbalization and sentence caches, if they are enabled in the
+  // configuration. Calling Setup() again starts with empty caches anyway, so
+  // this is only needed when the results may have changed for other reasons.
+  void ClearCaches() const;
+
   // Interface to the normalization system for callers that want to be agnostic
   // about utterances.
   bool Normalize(const string &input, string *output) const;
 
-  // normalizer.cc
   // Interface to the normalization system for callers that want to be agnostic
   // about utterances. Shows the token/word alignment.
   bool NormalizeAndShowLinks(const string &input, string *output) const;
 
-  // normalizer_utils.cc
+  // As Normalize(), also filling in the timings and sizes of the stages of
+  // normalization. See normalize_stats.h.
+  bool Normalize(const string &input,
+                 string *output,
+                 NormalizeStats *stats) const;
+
+  // Normalizes each of the inputs using up to num_threads threads, including
+  // the calling one, all of which share this normalizer. outputs is resized to
+  // match inputs, and an input that fails to normalize gets an empty
+  // output. Returns false if any of the inputs failed. The worker threads are
+  // kept for later batches.
+  bool NormalizeBatch(const std::vector<string> &inputs,
+                      std::vector<string> *outputs,
+                      int num_threads) const;
+
   // Helper for linearizing words from an utterance into a string
   string LinearizeWords(Utterance *utt) const;
 
-  // normalizer_utils.cc
   // Helper for showing the indices of all tokens, words and their alignment
   // links.
   string ShowLinks(Utterance *utt) const;
 
-  // normalizer.cc
   // Preprocessor to use the sentence splitter to break up text into
   // sentences. An application would normally call this first, and then
   // normalize each of the resulting sentences.
   std::vector<string> SentenceSplitter(const string &input) const;
 
+  // The loaded model, from which callers may create their own
+  // NormalizerSessions. Null until Setup() has succeeded.
+  std::shared_ptr<const NormalizerModel> model() const { return model_; }
+
  private:
-  // normalizer.cc
-  // Internal interface to normalization.
-  bool Normalize(Utterance *utt, const string &input) const;
-
-  // normalizer_utils.cc
-  // As in Kestrel, adds a phrase and silence.
-  // TODO(rws): Possibly remove this since it is actually not being used.
-  void AddPhraseToUtt(Utterance *utt) const { AddPhraseToUtt(utt, false); }
-
-  // normalizer_utils.cc
-  void AddPhraseToUtt(Utterance *utt, bool addword) const;
-
-  // normalizer_utils.cc
-  // Adds a single word to the end of the Word stream
-  Word* AddWord(Utterance *utt, Token *token,
-                const string &spelling) const;
-
-  // normalizer_utils.cc
-  // Function to add the words in the string 'name' onto the
-  // end of the Word stream.
-  Word* AddWords(Utterance *utt, Token *token,
-                 const string &name) const;
-
-  // Finds the index of the provided token.
-  int TokenIndex(Utterance *utt, Token *token) const;
-  // normalizer_utils.cc
-  // As with Peter's comment in
-  // speech/patts2/modules/kestrel/verbalize_general.cc, clear out all the mucky
-  // fields that we don't want verbalization to see.
-  void CleanFields(Token *markup) const;
-
-  // normalizer_utils.cc
-  // Returns the substring of the input between left and right
-  string InputSubstring(int left, int right) const;
-
-  // normalizer.cc
-  // Performs tokenization and classification on the input utterance, the first
-  // step of normalization
-  bool TokenizeAndClassifyUtt(Utterance *utt, const string &input) const;
-
-  // normalizer_utils.cc
-  // Serializes the contents of a Token to a string
-  string ToString(const Token &markup) const;
-
-  // normalizer.cc
-  // Verbalizes semiotic classes, defaulting to verbatim verbalization for
-  // something that is marked as a semiotic class but for which the
-  // verbalization grammar fails.
-  bool VerbalizeSemioticClass(const Token &markup, string *words) const;
-
-  // normalizer.cc
-  // Performs verbalization on the input utterance, the second step of
-  // normalization
-  bool VerbalizeUtt(Utterance *utt) const;
-
-  string input_;
-  std::unique_ptr<RuleSystem> tokenizer_classifier_rules_;
-  std::unique_ptr<RuleSystem> verbalizer_rules_;
-  std::unique_ptr<SentenceBoundary> sentence_boundary_;
-  std::unique_ptr<Serializer> spec_serializer_;
-  std::set<string> sentence_boundary_exceptions_;
+  // Calls fn with session_, or with a new session if another thread is using
+  // session_, and returns its result.
+  bool RunSession(const std::function<bool(NormalizerSession *)> &fn) const;
+
+  // Returns a pool with at least num_threads workers for NormalizeBatch(),
+  // replacing batch_pool_ with a larger one if need be.
+  std::shared_ptr<ThreadPool> GetBatchPool(int num_threads) const;
+
+  std::shared_ptr<const NormalizerModel> model_;
+  // Shared by concurrent batches. A batch that needed a larger pool keeps the
+  // one it replaced alive until it is done with it.
+  mutable std::shared_ptr<ThreadPool> batch_pool_;
+  mutable std::mutex batch_pool_mutex_;
+  // Created by Setup() for the single-sentence methods.
+  std::unique_ptr<NormalizerSession> session_;
+  mutable std::mutex session_mutex_;
 
   DISALLOW_COPY_AND_ASSIGN(Normalizer);
 };
@@ -0,0 +1,131 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// The loaded, read-only part of the normalizer: the tokenizer-classifier and
+// verbalizer grammars, the sentence boundary detector and the optional
+// serialization spec.
+//
+// A model is created once and never modified afterwards. It is handed out as a
+// std::shared_ptr so that any number of NormalizerSessions (see
+// normalizer_session.h), on any number of threads, can share one copy of the
+// grammars, and so that it stays alive for as long as any of them uses it.
+
+#ifndef SPARROWHAWK_NORMALIZER_MODEL_H_
+#define SPARROWHAWK_NORMALIZER_MODEL_H_
+
+#include <memory>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+#include <sparrowhawk/lru_cache.h>
+#include <sparrowhawk/sentence_boundary.h>
+#include <sparrowhawk/sparrowhawk_configuration.pb.h>
+#include <sparrowhawk/rule_system.h>
+#include <sparrowhawk/spec_serializer.h>
+#include <sparrowhawk/thread_pool.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+// The result of normalizing one sentence, as kept in the sentence cache.
+struct NormalizedSentence {
+  // The words, as from NormalizerSession::LinearizeWords().
+  string words;
+  // The token/word alignment, as from NormalizerSession::ShowLinks().
+  string links;
+};
+
+class NormalizerModel {
+ public:
+  // Loads the model described by the configuration_proto text proto, with all
+  // file names relative to pathname_prefix.
+  // Returns a null value if any part of the model fails to load.
+  static std::shared_ptr<const NormalizerModel> Create(
+      const string &configuration_proto, const string &pathname_prefix);
+
+  ~NormalizerModel();
+
+  // Pages in all of the grammars. See RuleSystem::Warmup().
+  void Warmup() const;
+
+  // Writes the grammar caches of the tokenizer-classifier and verbalizer
+  // grammars. See RuleSystem::SaveCache().
+  bool SaveGrammarCaches() const;
+
+  // Empties the verbalization and sentence caches.
+  void ClearCaches() const;
+
+  // Uses the sentence splitter to break up text into sentences.
+  std::vector<string> SentenceSplitter(const string &input) const;
+
+  const SentenceBoundary &sentence_boundary() const {
+    return *sentence_boundary_;
+  }
+
+  const SparrowhawkConfiguration &configuration() const {
+    return configuration_;
+  }
+
+  const RuleSystem &tokenizer_classifier_rules() const {
+    return *tokenizer_classifier_rules_;
+  }
+
+  const RuleSystem &verbalizer_rules() const { return *verbalizer_rules_; }
+
+  // Null when the configuration does not name a serialization spec, in which
+  // case tokens are serialized with the ProtobufSerializer.
+  const Serializer *spec_serializer() const { return spec_serializer_.get(); }
+
+  // Verbalizations of semiotic class tokens, keyed by the serialized token
+  // after CleanFields(). The cache locks internally, so it may be used from any
+  // number of sessions at once. Null when disabled in the configuration.
+  LruCache<string> *verbalization_cache() const {
+    return verbalization_cache_.get();
+  }
+
+  // Normalized sentences, keyed by the input sentence. Locks internally like
+  // the verbalization cache. Null when disabled in the configuration.
+  LruCache<NormalizedSentence> *sentence_cache() const {
+    return sentence_cache_.get();
+  }
+
+  // Pool on which the semiotic class tokens of a sentence are verbalized,
+  // shared by all sessions. Null when verbalization is not parallel.
+  ThreadPool *verbalizer_pool() const { return verbalizer_pool_.get(); }
+
+ private:
+  // Only used by the factory function Create.
+  NormalizerModel();
+
+  // Loads and sets all the data for the model.
+  bool Setup(const string &configuration_proto, const string &pathname_prefix);
+
+  SparrowhawkConfiguration configuration_;
+  std::unique_ptr<RuleSystem> tokenizer_classifier_rules_;
+  std::unique_ptr<RuleSystem> verbalizer_rules_;
+  std::unique_ptr<SentenceBoundary> sentence_boundary_;
+  std::unique_ptr<Serializer> spec_serializer_;
+  std::unique_ptr<LruCache<string>> verbalization_cache_;
+  std::unique_ptr<LruCache<NormalizedSentence>> sentence_cache_;
+  std::unique_ptr<ThreadPool> verbalizer_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(NormalizerModel);
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_NORMALIZER_MODEL_H_
@@ -0,0 +1,198 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// A NormalizerSession runs the normalization pipeline against a shared
+// NormalizerModel (normalizer_model.h): tokenization and classification of each
+// sentence, followed by verbalization of the resulting tokens.
+//
+// The session owns all the per-call working state: the utterance, the string
+// compiler and the intermediate transducers. These are kept between calls and
+// reused, so after the first few sentences a session does very little heap
+// allocation of its own. A session is therefore not thread safe; the intended
+// use is one session per thread, all sharing a single model.
+
+#ifndef SPARROWHAWK_NORMALIZER_SESSION_H_
+#define SPARROWHAWK_NORMALIZER_SESSION_H_
+
+#include <memory>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+#include <sparrowhawk/items.pb.h>
+#include <sparrowhawk/lru_cache.h>
+#include <sparrowhawk/normalize_stats.h>
+#include <sparrowhawk/normalizer_model.h>
+#include <sparrowhawk/rule_system.h>
+#include <sparrowhawk/thread_pool.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+class NormalizerSession {
+ public:
+  explicit NormalizerSession(std::shared_ptr<const NormalizerModel> model);
+
+  ~NormalizerSession();
+
+  // The functions definitions have been split across two files,
+  // normalizer_session.cc and normalizer_utils.cc, just to keep things a
+  // littler tidier. Below we indicate where each function is found.
+
+  // normalizer_session.cc
+  // Normalizes a single sentence, returning the words as a string.
+  bool Normalize(const string &input, string *output);
+
+  // normalizer_session.cc
+  // As above, but shows the token/word alignment.
+  bool NormalizeAndShowLinks(const string &input, string *output);
+
+  // normalizer_session.cc
+  // As above, also filling in the stats of the call. A null stats collects
+  // none, unless the process-wide stats are enabled.
+  bool Normalize(const string &input, string *output, NormalizeStats *stats);
+
+  bool NormalizeAndShowLinks(const string &input,
+                             string *output,
+                             NormalizeStats *stats);
+
+  // normalizer_utils.cc
+  // Helper for linearizing words from an utterance into a string
+  static string LinearizeWords(const Utterance &utt);
+
+  // normalizer_utils.cc
+  // Helper for showing the indices of all tokens, words and their alignment
+  // links.
+  static string ShowLinks(const Utterance &utt);
+
+  const NormalizerModel &model() const { return *model_; }
+
+ private:
+  // normalizer_session.cc
+  // Internal interface to normalization, which leaves its result in utt_.
+  bool Normalize(const string &input);
+
+  // normalizer_session.cc
+  // Points stats_ at where the stats of a call should go, if anywhere, and
+  // clears them.
+  void StartStats(NormalizeStats *stats);
+
+  // normalizer_session.cc
+  // Adds the stats of a call to the process-wide ones, if they are enabled.
+  void FinishStats();
+
+  // normalizer_session.cc
+  // Fills sentence_ for input, from the sentence cache if it is there and by
+  // normalizing it and adding it to the cache otherwise.
+  bool NormalizeCached(const string &input,
+                       LruCache<NormalizedSentence> *cache);
+
+  // normalizer_utils.cc
+  // As in Kestrel, adds a phrase and silence.
+  // TODO(rws): Possibly remove this since it is actually not being used.
+  void AddPhraseToUtt(Utterance *utt) const { AddPhraseToUtt(utt, false); }
+
+  // normalizer_utils.cc
+  void AddPhraseToUtt(Utterance *utt, bool addword) const;
+
+  // normalizer_utils.cc
+  // Adds a single word to the end of the Word stream
+  Word* AddWord(Utterance *utt, Token *token,
+                const string &spelling) const;
+
+  // normalizer_utils.cc
+  // Function to add the words in the string 'name' onto the
+  // end of the Word stream.
+  Word* AddWords(Utterance *utt, Token *token,
+                 const string &name) const;
+
+  // Finds the index of the provided token.
+  int TokenIndex(Utterance *utt, Token *token) const;
+
+  // normalizer_utils.cc
+  // As with Peter's comment in
+  // speech/patts2/modules/kestrel/verbalize_general.cc, clear out all the mucky
+  // fields that we don't want verbalization to see.
+  void CleanFields(Token *markup) const;
+
+  // normalizer_session.cc
+  // Performs tokenization and classification on the input utterance, the first
+  // step of normalization
+  bool TokenizeAndClassifyUtt(Utterance *utt, const string &input);
+
+  // normalizer_utils.cc
+  // Serializes the contents of a Token to a string
+  string ToString(const Token &markup) const;
+
+  // Working state for verbalizing one token. A session has one for each token
+  // it verbalizes concurrently.
+  struct Verbalization {
+    Token token;
+    MutableTransducer input;
+    string cache_key;
+    // The result.
+    string words;
+    bool success;
+    // Stats, when they are being collected.
+    bool cache_hit;
+    int64 serialization_usec;
+    int64 verbalizer_usec;
+  };
+
+  // normalizer_session.cc
+  // Verbalizes a semiotic class, leaving the words in verbalization. This only
+  // uses the shared model and verbalization, so calls with different
+  // verbalizations may run concurrently.
+  bool VerbalizeSemioticClass(const Token &markup,
+                              Verbalization *verbalization) const;
+
+  // normalizer_session.cc
+  // Adds the stats of a verbalization to stats_, if they are being collected.
+  void AddVerbalizationStats(const Verbalization &verbalization);
+
+  // normalizer_session.cc
+  // Verbalizes all the semiotic classes of the utterance on the pool, leaving
+  // the result for the i'th token in verbalizations_[i].
+  void VerbalizeSemioticClassesInParallel(const Utterance &utt,
+                                          ThreadPool *pool);
+
+  // normalizer_session.cc
+  // Performs verbalization on the input utterance, the second step of
+  // normalization, defaulting to verbatim verbalization for something that is
+  // marked as a semiotic class but for which the verbalization grammar fails.
+  bool VerbalizeUtt(Utterance *utt);
+
+  std::shared_ptr<const NormalizerModel> model_;
+
+  // Working state, reused from call to call.
+  Utterance utt_;
+  LabelPath best_path_;
+  // Where the stats of the current call go, or null.
+  NormalizeStats *stats_;
+  // Stats of the current call when they are only wanted for the process-wide
+  // ones.
+  NormalizeStats call_stats_;
+  Verbalization verbalization_;
+  std::vector<Verbalization> verbalizations_;
+  std::vector<int> semiotic_class_tokens_;
+  NormalizedSentence sentence_;
+
+  DISALLOW_COPY_AND_ASSIGN(NormalizerSession);
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_NORMALIZER_SESSION_H_
@@ -33,6 +33,7 @@ using std::vector;
 #include <google/protobuf/message.h>
 #include <google/protobuf/descriptor.h>
 #include <thrax/grm-manager.h>
+#include <sparrowhawk/best_path.h>
 
 namespace speech {
 namespace sparrowhawk {
@@ -45,7 +46,11 @@ class ProtobufParser {
  public:
   typedef GrmManager::Transducer Transducer;
 
+  // Reads the path of fst up front; fst is not used after construction.
   explicit ProtobufParser(const Transducer *fst);
+
+  // Parses the labels of a path, such as one found by BestPath().
+  explicit ProtobufParser(const LabelPath &path);
   ~ProtobufParser();
 
   // Parses tokens from the member FST into the Token stream of the
@@ -91,11 +96,11 @@ class ProtobufParser {
   // Consumes any output whitespace from the FST.
   void ConsumeWhitespace();
 
-  // Moves to the next state in the FST. Returns true if one was found, false
+  // Moves to the next arc of the path. Returns true if one was found, false
   // if the end has been reached.
   bool NextState();
 
-  // Backs up to the previous state. Can only back up once, so should only be
+  // Backs up to the previous arc. Can only back up once, so should only be
   // called once between each call to NextState().
   void PrevState();
 
@@ -120,12 +125,13 @@ class ProtobufParser {
                 const google::protobuf::FieldDescriptor *descriptor,
                 const string &value) const;
 
-  // FST we're parsing from.
-  const Transducer *fst_;
-  // Current state that we're up to.
-  StateId state_;
-  // The previous state
-  StateId last_state_;
+  // Whether the FST we're parsing from has a start state.
+  bool has_start_;
+  // Input and output labels of the arcs along the FST's path, which is
+  // extracted once up front so that parsing is a scan over this array.
+  LabelPath path_;
+  // Index in path_ of the next arc to consume.
+  size_t position_;
   // Input/output labels from the last arc.
   Label ilabel_;
   Label olabel_;
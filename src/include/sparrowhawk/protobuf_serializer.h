@@ -15,7 +15,17 @@
 // into a FST in preparation for them to be verbalized.
 // The main advantage of this for us is that we produce a FST with multiple
 // orderings which the verbalizer can consume however it wants; this
-// removes the necessity for the prior reordering hacks etc.
+// removes the necessity for the prior reordering hacks etc. All the orderings
+// of a message's fields share one acceptor with a state for each subset of the
+// fields output so far, rather than one path per permutation.
+//
+// Each field's value is copied onto every arc between subsets that adds it,
+// so n fields cost 2^n states and n * 2^(n-1) copies of the values. Messages
+// with more than max_any_order_fields of them (7 by default, and set in
+// SparrowhawkConfiguration) are serialized in field number order only, and a
+// warning is logged once for each such message type. The default keeps every
+// ordering that the old permutation code serialized, its 5040 being all the
+// orderings of 7 fields, and stays well below its cost.
 //
 // As with ProtobufParser, this class is not threadsafe as it stores
 // internal state; the expectation is to create temporary local instances
@@ -24,6 +34,7 @@
 #ifndef SPARROWHAWK_PROTOBUF_SERIALIZER_H_
 #define SPARROWHAWK_PROTOBUF_SERIALIZER_H_
 
+#include <algorithm>
 #include <vector>
 using std::vector;
 
@@ -52,6 +63,17 @@ class ProtobufSerializer {
   // Serializes the message into the FST.
   void SerializeToFst();
 
+  // Sets the largest number of fields set in a message for which all their
+  // orderings are serialized. It cannot be raised above
+  // kMaxMaxAnyOrderFields, as the acceptor would have millions of states.
+  void set_max_any_order_fields(int max_any_order_fields) {
+    max_any_order_fields_ =
+        std::min(max_any_order_fields, kMaxMaxAnyOrderFields);
+  }
+
+  static const int kDefaultMaxAnyOrderFields = 7;
+  static const int kMaxMaxAnyOrderFields = 20;
+
   // Serializes the message into a string
   string SerializeToString() const;
 
@@ -71,13 +93,53 @@ class ProtobufSerializer {
   // Serializes the entire message into the FST, and returns the final state id.
   StateId SerializeToFstInternal();
 
-  // Serializes a single permutation into the FST.
-  void SerializePermutation(const FieldDescriptorVector &fields);
+  struct FieldPlan;
+  struct Fragment;
+  struct MessagePlan;
+
+  // Returns the plan for serializing messages of the given type, shared by all
+  // serializers. The plans of Token and of all the message types it can
+  // contain are worked out together on first use, and then looked up without
+  // locking. Other types have theirs worked out when they are first seen.
+  static const MessagePlan *GetMessagePlan(
+      const google::protobuf::Descriptor *descriptor);
+
+  static const MessagePlan *MakeMessagePlan(
+      const google::protobuf::Descriptor *descriptor);
+
+  static void MakeFieldPlan(const FieldDescriptor *field, FieldPlan *plan);
+
+  // Serializes the fields one after the other, in the given order, and returns
+  // the final state.
+  StateId SerializeInOrder(const FieldDescriptorVector &fields);
+
+  // Serializes the fields in all possible orders, and returns the final state.
+  StateId SerializeInAnyOrder(const FieldDescriptorVector &fields);
 
-  // Serializes a single field into the FST.
-  StateId SerializeField(const FieldDescriptor *field,
-                         int index,
-                         StateId state);
+  // Serializes all the values of a field, separated by spaces, into a
+  // fragment.
+  void SerializeFragment(const FieldDescriptor *field,
+                         Fragment *fragment) const;
+
+  // Adds a copy of fragment to the FST, leading from from to to.
+  void GraftFragment(const Fragment &fragment, StateId from, StateId to);
+
+  // Returns a state reached by both the given states, where none may be
+  // kNoStateId.
+  StateId JoinFinalStates(StateId emitted, StateId none);
+
+  // Serializes a single value of a field into the FST.
+  StateId SerializeField(const FieldPlan &plan, int index, StateId state);
+
+  // Serializes a submessage, and the brace that closes it, into the FST.
+  StateId SerializeMessage(const google::protobuf::Message &message,
+                           StateId state);
+
+  // Serializes a string value in quotes, with an alternate path without them.
+  StateId SerializeQuotedString(const string &str, StateId state);
+
+  // Serializes size characters into the FST.
+  StateId SerializeChars(const char *str, size_t size, StateId state);
 
   // Serializes a string into the FST.
   StateId SerializeString(const string &str, StateId state);
@@ -90,16 +152,12 @@ class ProtobufSerializer {
   // Serializes a single character into the FST.
   StateId SerializeChar(char c, StateId state);
 
-  // Links the last arc that has a non-space output symbol to the new final
-  // state by adding an epsilon arc from this arc's destination state to the new
-  // final state, cutting out unnecessary whitespace and connecting multiple
-  // permutations to a common destination.
-  void StripTrailingSpace(StateId new_final_state);
-
   const google::protobuf::Message *message_;
   const google::protobuf::Reflection *reflection_;
   MutableTransducer *fst_;
   const StateId initial_state_;
+  const MessagePlan *plan_;
+  int max_any_order_fields_;
   static const RE2 kReTrailingZeroes;
   static const int kReNumMatchGroups;
 
@@ -28,6 +28,8 @@
 #define SPARROWHAWK_RECORD_SERIALIZER_H_
 
 #include <memory>
+#include <string>
+using std::string;
 #include <vector>
 using std::vector;
 
@@ -35,8 +37,7 @@ using std::vector;
 #include <thrax/grm-manager.h>
 #include <sparrowhawk/items.pb.h>
 #include <sparrowhawk/serialization_spec.pb.h>
-#include <sparrowhawk/field_path.h>
-#include <re2/re2.h>
+#include <sparrowhawk/field_trie.h>
 
 namespace speech {
 namespace sparrowhawk {
@@ -45,28 +46,40 @@ class RecordSerializer {
  public:
   typedef fst::StdVectorFst MutableTransducer;
 
-  // Creates and returns a RecordSerializer from the record_spec by noting the
-  // field path and path label the record and recursively building
-  // record_serializers for prefix and suffix specs.
+  // Creates and returns a RecordSerializer from the record_spec by adding the
+  // field path to trie, noting the path label of the record and recursively
+  // building record_serializers for prefix and suffix specs.
   // Returns a null value if the spec is not well-formed.
   static std::unique_ptr<RecordSerializer> Create(
-      const RecordSpec &record_spec);
+      const RecordSpec &record_spec, FieldTrie *trie);
 
   // Serializes a token using the record spec, returns true only if the token
-  // serializes correctly as per the record spec. For the input token, it
-  // recursively traverses field_paths noted in the record_serializer and its
-  // affix_serializers and concatenates serialized field content onto the
-  // input fst.
-  bool Serialize(const Token &token, MutableTransducer *fst) const;
+  // serializes correctly as per the record spec. The token is read through
+  // messages, of the trie passed to Create(), and the fields of the record
+  // and its affix_serializers are appended onto the input fst, which must be
+  // a string transducer under construction: the path it is appended to ends
+  // in the last state of fst. On failure, fst may be left with part of the
+  // serialization.
+  bool Serialize(FieldTrie::Messages *messages, MutableTransducer *fst) const;
+
+  // Appends the bytes of a string to fst, which is extended from its last
+  // state as above.
+  static void AppendString(const string &bytes, MutableTransducer *fst);
 
  private:
   typedef MutableTransducer::Arc Arc;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
-  typedef fst::StringCompiler<Arc> StringCompiler;
 
   // Only used by the factory function Create.
-  RecordSerializer();
+  RecordSerializer() {}
+
+  // As AppendString(), for size bytes.
+  static void AppendBytes(const char *bytes, size_t size,
+                          MutableTransducer *fst);
+
+  // As AppendString(), escaping record_separator and escape_character.
+  static void AppendEscaped(const string &value, MutableTransducer *fst);
 
   // Serializers for prefix specs in the specification.
   std::vector<std::unique_ptr<RecordSerializer>> prefix_serializers_;
@@ -74,53 +87,41 @@ class RecordSerializer {
   // Serializers for suffix specs in the specification.
   std::vector<std::unique_ptr<RecordSerializer>> suffix_serializers_;
 
-  // Field path for the record_spec field.
-  std::unique_ptr<FieldPath> field_path_;
+  // The record_spec field, in the trie.
+  FieldTrie::Field field_;
 
-  // String denoting the terminating field's name for the record spec.
-  string field_name_;
+  // The terminating field's name for the record spec, followed by the label
+  // separator.
+  string record_label_;
 
   // Default value to be emitted when field is not set.
   string default_value_;
 
-  // Pattern to be escaped - record_separator or escape_character.
-  RE2 escape_re_;
-
-  // Replacement string for escape pattern - prepended escape_character.
-  string escape_replacement_;
-
-  // String Compiler for making fsts from strings.
-  StringCompiler string_compiler_;
-
-  // Serializes a record, escaping record_separator and escape_character.
-  // Also serializes various factorizations as parallel arcs into the FST.
-  void SerializeRecord(string *value,
-                       MutableTransducer *fst) const;
+  // Appends a record, escaping record_separator and escape_character.
+  void SerializeRecord(const string &value, MutableTransducer *fst) const;
 
   // Assumes that the (non-repeated) field is set for the parent, and checks
-  // that it corresponds to a scalar value. Also, in this case, adds an arc to
-  // fst between states start and end, optionally adding a new state for end if
-  // a sentinel is passed for end. It is an error to invoke this with a
-  // repeated field.
+  // that it corresponds to a scalar value. Also, in this case, appends its
+  // record to fst. It is an error to invoke this with a repeated field.
   bool SerializeToFst(const google::protobuf::Message &parent,
                       const google::protobuf::FieldDescriptor &field,
                       MutableTransducer *fst) const;
 
   // Assumes that the (repeated) field is set for the parent, and checks that it
-  // corresponds to a scalar value. Also, in this case, adds an arc to
-  // fst between states start and end, optionally adding a new state for end if
-  // a sentinel is passed for end. It is an error to invoke this with a
+  // corresponds to a scalar value. Also, in this case, appends the record of
+  // its index-th value to fst. It is an error to invoke this with a
   // non-repeated field.
   bool SerializeToFstRepeated(const google::protobuf::Message &parent,
                               const google::protobuf::FieldDescriptor &field,
                               const int index,
                               MutableTransducer *fst) const;
 
-  // Recursively serializes prefix and suffix records into respective
-  // transducers using appropriate record serializers.
-  bool SerializeAffixes(const Token &token,
-                        MutableTransducer *prefix_fst,
-                        MutableTransducer *suffix_fst) const;
+  // Recursively serializes prefix or suffix records onto fst using the
+  // affix_serializers.
+  static bool SerializeAffix(
+      FieldTrie::Messages *messages,
+      const std::vector<std::unique_ptr<RecordSerializer>> &affix_serializers,
+      MutableTransducer *fst);
 
   DISALLOW_COPY_AND_ASSIGN(RecordSerializer);
 };
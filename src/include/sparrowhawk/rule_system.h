@@ -14,6 +14,9 @@
 // A rule system consists of a cascaded set of grammar targets defined by
 // Thrax. See rule_order.proto for a description of what each rule complex can
 // contain.
+//
+// Once loaded, a RuleSystem may be shared between threads: ApplyRules() and
+// FindRule() can be called concurrently.
 #ifndef SPARROWHAWK_RULE_SYSTEM_H_
 #define SPARROWHAWK_RULE_SYSTEM_H_
 
@@ -21,10 +24,14 @@
 #include <memory>
 #include <string>
 using std::string;
+#include <utility>
+#include <vector>
+using std::vector;
 
 #include <fst/compat.h>
 #include <google/protobuf/text_format.h>
 #include <thrax/grm-manager.h>
+#include <sparrowhawk/best_path.h>
 #include <sparrowhawk/rule_order.pb.h>
 
 namespace speech {
@@ -43,19 +50,82 @@ typedef StdILabelLookAheadFst LookaheadFst;
 
 class RuleSystem {
  public:
-  RuleSystem() { }
+  RuleSystem()
+      : prepare_lookaheads_(true), num_load_threads_(1), memory_map_(false) { }
   ~RuleSystem();
 
   // Loads a protobuf containing the filename of the grammar far
   // and the rule specifications as defined in rule_order.proto.
+  // Unless disabled with set_prepare_lookaheads(), this also prepares the
+  // lookahead transducers for all the rules that can use one, so that the
+  // first call to ApplyRules() costs the same as any other. They are read from
+  // the grammar cache (see SaveCache()) when it is present and up to date, and
+  // built from the grammar otherwise. A grammar that asks for its rules to be
+  // precomposed has them composed here too, unless the cache already holds
+  // the composition.
   bool LoadGrammar(const string& filename, const string& prefix);
 
+  // Writes the prepared lookahead transducers, and input-sorted const copies of
+  // the rules, to the grammar cache, a file next to the far with kCacheSuffix
+  // appended to its name. The cache records the size, modification time and a
+  // fingerprint of the far it was built from and is ignored once the far
+  // changes. The fingerprint is only checked when the far has been touched.
+  bool SaveCache() const;
+
+  static const char kCacheSuffix[];
+
+  // Sets whether LoadGrammar() builds the lookahead transducers. A rule system
+  // that is never applied with use_lookahead can skip them and save the time
+  // and memory. Applying such a system with use_lookahead falls back to plain
+  // composition.
+  void set_prepare_lookaheads(bool prepare_lookaheads) {
+    prepare_lookaheads_ = prepare_lookaheads;
+  }
+
+  // Sets the number of threads LoadGrammar() uses to build the lookahead
+  // transducers.
+  void set_num_load_threads(int num_load_threads) {
+    num_load_threads_ = num_load_threads;
+  }
+
+  // Sets whether LoadGrammar() serves the rules memory-mapped from the grammar
+  // cache rather than loading the far into memory. This is only possible when
+  // the cache is up to date; otherwise the far is loaded as usual.
+  void set_memory_map(bool memory_map) { memory_map_ = memory_map; }
+
+  // Touches every state and arc of the rule and lookahead transducers, so
+  // that none of them are paged in on the first real request.
+  void Warmup() const;
+
   // This one returns the epsilon-free output projection of all
   // paths. use_lookahead constructs a lookahead FST for the composition.
+  // Fails if the output of any rule outgrows the limits set in the grammar.
   bool ApplyRules(const Transducer& input,
                   MutableTransducer* output,
                   bool use_lookahead) const;
 
+  // Finds the best path of the output of all the rules, as ApplyRules() and
+  // then fst::ShortestPath() would, and stores its labels in path. The output
+  // of the last rule is searched as it is composed, without being built in
+  // full. Like the output of ApplyRules(), the path keeps the input labels of
+  // arcs with epsilon outputs. If num_states and num_arcs are not null, they
+  // are set to the size of the part of the last rule's output that was
+  // searched.
+  bool ApplyRulesToBestPath(const Transducer& input,
+                            bool use_lookahead,
+                            LabelPath* path,
+                            int64* num_states = nullptr,
+                            int64* num_arcs = nullptr) const;
+
+  // As above, for the bytes of input. With use_lookahead, the string
+  // transducer is built with its labels already as the lookahead composition
+  // with the first rule needs them, rather than compiled and then relabeled.
+  bool ApplyRulesToBestPath(const string& input,
+                            bool use_lookahead,
+                            LabelPath* path,
+                            int64* num_states = nullptr,
+                            int64* num_arcs = nullptr) const;
+
   // These two return the string of the shortest path.
   bool ApplyRules(const string& input,
                   string* output,
@@ -74,8 +144,148 @@ class RuleSystem {
   Grammar grammar_;
   string grammar_name_;
   std::unique_ptr<GrmManager> grm_;
+  // Reads lookaheads_, and mapped_rules_ if memory_map_ is set, from the
+  // grammar cache. Without memory_map_, a cached precomposed rule is read into
+  // precomposed_ instead. Returns false, leaving them all empty, if there is no
+  // usable cache.
+  bool LoadCache();
+
+  // Whether mapped_rules_ holds every rule needed to apply the grammar.
+  bool HasMappedRules() const;
+
+  // A rule with PDT parens, ready for composition.
+  struct PdtRule {
+    // The rule, input-sorted.
+    const Transducer* fst;
+    // Owns fst if the rule needed sorting.
+    std::unique_ptr<MutableTransducer> sorted_fst;
+    std::vector<std::pair<fst::StdArc::Label, fst::StdArc::Label>> parens;
+    // The stack of each paren, for an MPDT. Empty for a PDT.
+    std::vector<fst::StdArc::Label> assignments;
+  };
+
+  // The input labels a reduplication rule can start with, so that inputs it
+  // cannot match skip reduplication without composing them with the rule.
+  struct RedupFilter {
+    RedupFilter() : any_label(false) { }
+
+    // Whether the rule can match input, as far as the labels on the arcs out
+    // of their start states tell. Only the output labels of input count.
+    bool MayMatch(const Transducer& input) const;
+
+    // Set when the first state of the rule is no help.
+    bool any_label;
+    // Sorted.
+    std::vector<fst::StdArc::Label> first_labels;
+  };
+
+  // Adds to input the reduplicated copy of it that the reduplication rule
+  // gave, that is the union of input and redup concatenated with itself.
+  static void AddReduplication(const MutableTransducer& redup,
+                               MutableTransducer* input);
+
+  // Fills redup_filters_ for the rules of grammar_.
+  void PrepareRedupFilters();
+
+  // The relabeling LabelLookAheadRelabeler does for a lookahead transducer,
+  // as a table built once. Unlike LabelLookAheadRelabeler, it never adds to
+  // the label data shared by the users of the transducer.
+  class RelabelTable {
+   public:
+    explicit RelabelTable(const LookaheadFst& lookahead_fst);
+
+    fst::StdArc::Label Relabel(fst::StdArc::Label label) const;
+
+    // Relabels the output labels of fst.
+    void Relabel(MutableTransducer* fst) const;
+
+   private:
+    // Labels from here up are looked up in sparse_.
+    static const fst::StdArc::Label kMaxDenseLabel = 0xFFFF;
+
+    // Indexed by label.
+    std::vector<fst::StdArc::Label> dense_;
+    // Sorted by label.
+    std::vector<std::pair<fst::StdArc::Label, fst::StdArc::Label>> sparse_;
+    fst::StdArc::Label unknown_index_;
+
+    DISALLOW_COPY_AND_ASSIGN(RelabelTable);
+  };
+
+  // Whether the rule_index-th rule is composed with its lookahead transducer.
+  bool UsesLookahead(int rule_index, bool use_lookahead) const;
+
+  // Applies the rule_index-th rule, with its reduplication if it has one, to
+  // input. The result is a lazy composition when the rule's lookahead
+  // transducer is used. Reduplication and relabeling for the lookahead modify
+  // input; input_relabeled says the relabeling is already done. If
+  // best_path_only is set, a PDT rule may give just the best path of its
+  // output.
+  bool ApplyRule(int rule_index,
+                 MutableTransducer* input,
+                 bool use_lookahead,
+                 bool input_relabeled,
+                 bool best_path_only,
+                 std::unique_ptr<Transducer>* output) const;
+
+  // Does the work of ApplyRulesToBestPath(), consuming input.
+  bool FindBestPath(MutableTransducer* input,
+                    bool input_relabeled,
+                    bool use_lookahead,
+                    LabelPath* path,
+                    int64* num_states,
+                    int64* num_arcs) const;
+
+  // Applies a PDT or MPDT rule to input and expands the result, or for a PDT
+  // with best_path_only, finds its best path. The parens are removed.
+  bool ApplyPdtRule(const PdtRule& pdt_rule,
+                    const Transducer& input,
+                    bool best_path_only,
+                    MutableTransducer* output) const;
+
+  // Fills pdt_rules_ for the rules of grammar_.
+  bool PreparePdtRules();
+
+  // Builds the output of a rule within the size limits of the grammar, and
+  // prunes it if the grammar asks for that. Returns false if the output is
+  // empty or too large. An output that ApplyRule() has already built is only
+  // checked against the limits and taken over, not copied.
+  bool ExpandRuleOutput(const Rule& rule,
+                        std::unique_ptr<Transducer> rule_output,
+                        MutableTransducer* output) const;
+
+  // Applies a single rule without parens to input, like
+  // GrmManager::Rewrite().
+  bool Rewrite(const string& rule,
+               const Transducer& input,
+               MutableTransducer* output) const;
+
+  // Builds the entries of lookaheads_ missing for rules without PDT parens.
+  bool BuildLookaheads();
+
+  // Composes the rules of cascade into precomposed_, then determinizes and
+  // minimizes the result as a weighted acceptor over pairs of labels.
+  bool Precompose(const Grammar& cascade);
+
+  string grm_file_;
+
+  bool prepare_lookaheads_;
+  int num_load_threads_;
+  bool memory_map_;
+  // Rules mapped from the grammar cache. When this is in use grm_ is null.
+  std::map<string, std::unique_ptr<const Transducer>> mapped_rules_;
+  // The composition of the rules, when the grammar asks for it. It is then
+  // the one rule of grammar_, under the name precomposed_name_.
+  std::unique_ptr<const Transducer> precomposed_;
+  string precomposed_name_;
+  // Indexed like the rules of grammar_, and null for rules without parens.
+  std::vector<std::unique_ptr<PdtRule>> pdt_rules_;
+  // Indexed like the rules of grammar_, and only used for rules with redup.
+  std::vector<RedupFilter> redup_filters_;
   // Precomputed lookahead transducers
-  mutable std::map<string, LookaheadFst*> lookaheads_;
+  std::map<string, std::unique_ptr<LookaheadFst>> lookaheads_;
+  // The relabeling for each of lookaheads_.
+  std::map<string, std::unique_ptr<const RelabelTable>> relabel_tables_;
 };
 
 }  // namespace sparrowhawk
@@ -0,0 +1,15 @@
+// Generated by protoc-gen-sparrowhawk from semiotic_classes.proto. DO NOT EDIT.
+
+#ifndef SPARROWHAWK_SEMIOTIC_CLASSES_FIELDS_H_
+#define SPARROWHAWK_SEMIOTIC_CLASSES_FIELDS_H_
+
+namespace speech {
+namespace sparrowhawk {
+
+// Registers the MessageFields of the message types in semiotic_classes.proto.
+void RegisterSemioticClassesMessageFields();
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_SEMIOTIC_CLASSES_FIELDS_H_
@@ -42,6 +42,11 @@ class SentenceBoundary {
 
   std::vector<string> ExtractSentences(const string &input_text) const;
 
+  // Returns the positions in input_text just after each sentence boundary, in
+  // increasing order. Whether a candidate is a boundary only depends on the
+  // text since the previous boundary, so text can be split incrementally.
+  std::vector<int> FindCutpoints(const string &input_text) const;
+
   // If true, then prefixes each exception in the exception list with a space,
   // so that it when matching against a potential end-of-sentence position, it
   // will force the match to occur only when there is a preceding space, or at
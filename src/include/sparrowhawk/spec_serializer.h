@@ -13,20 +13,24 @@
 // Copyright 2015 and onwards Google, Inc.
 // Serializes a token based on a given spec for simple, fast verbalization.
 // Iteratively serializes the styles in a class_spec which are concatenated as
-// parallel arcs onto a transducer, which is returned as output.
+// parallel paths onto a transducer, which is returned as output once it is
+// made deterministic and minimal.
 
 #ifndef SPARROWHAWK_SPEC_SERIALIZER_H_
 #define SPARROWHAWK_SPEC_SERIALIZER_H_
 
-#include <map>
 #include <memory>
+#include <string>
+using std::string;
 #include <vector>
 using std::vector;
 
 #include <fst/compat.h>
 #include <google/protobuf/descriptor.h>
 #include <thrax/grm-manager.h>
+#include <sparrowhawk/field_trie.h>
 #include <sparrowhawk/items.pb.h>
+#include <sparrowhawk/message_fields.h>
 #include <sparrowhawk/serialization_spec.pb.h>
 #include <sparrowhawk/style_serializer.h>
 
@@ -46,23 +50,40 @@ class Serializer {
 
   // Serializes a token using the serialization spec, i.e. builds an fst
   // corresponding to the serialization of the token. Appends a label for the
-  // semiotic class name at the front and then adds parallel arcs for the
-  // different valid style_specs.
+  // semiotic class name at the front and then adds parallel paths for the
+  // different valid style_specs. The result is an epsilon-free acceptor, and
+  // when more than one style applies, it is determinized and minimized.
   MutableTransducer Serialize(const Token &token) const;
 
+  // As above, but builds the serialization in fst, replacing its contents.
+  void Serialize(const Token &token, MutableTransducer *fst) const;
+
  private:
   typedef MutableTransducer::Arc Arc;
-  typedef fst::StringCompiler<Arc> StringCompiler;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
 
   // Only used by the factory function Create.
-  Serializer() : string_compiler_(fst::StringTokenType::BYTE) {}
+  Serializer() : field_trie_(Token::descriptor()), token_fields_(nullptr) {}
+
+  // The serialization of a semiotic class.
+  struct ClassSerializer {
+    // The name of the class followed by the class separator.
+    string label;
+    // The fields the styles require or prohibit.
+    FieldPresence presence;
+    std::vector<std::unique_ptr<StyleSerializer>> styles;
+  };
+
+  // The serialization of each class, indexed by the number of its field in
+  // Token, and null for fields without one.
+  std::vector<std::unique_ptr<ClassSerializer>> serializers_;
 
-  // String Compiler for making fsts from strings.
-  StringCompiler string_compiler_;
+  // The field paths of all the classes.
+  FieldTrie field_trie_;
 
-  // Map to store the serialization indexed by field descriptors.
-  std::map<const google::protobuf::FieldDescriptor*,
-  std::vector<std::unique_ptr<StyleSerializer>>> serializers_;
+  // Generated field accessors for Token, or null to use reflection.
+  const MessageFields *token_fields_;
 
   DISALLOW_COPY_AND_ASSIGN(Serializer);
 };
@@ -0,0 +1,89 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// Normalizes text that arrives in pieces, such as a document read line by line.
+//
+// Text is passed in with Feed() as it becomes available. Each sentence is
+// normalized, and handed to the callback, as soon as the sentence boundary
+// detector has seen enough of the following text to be sure where it ends, so
+// only the current unfinished sentence is ever buffered. Flush() normalizes
+// whatever is left at the end of the input.
+//
+// The sentences are the same as SentenceSplitter() would find in the whole
+// text, except that a sentence longer than the maximum buffer size is cut at
+// its last space.
+//
+// Like a NormalizerSession, which it uses, a StreamingNormalizer is meant to be
+// used from one thread at a time.
+
+#ifndef SPARROWHAWK_STREAMING_NORMALIZER_H_
+#define SPARROWHAWK_STREAMING_NORMALIZER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+using std::string;
+
+#include <fst/compat.h>
+#include <sparrowhawk/normalizer_model.h>
+#include <sparrowhawk/normalizer_session.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+class StreamingNormalizer {
+ public:
+  // Called with the normalization of each sentence, in order. A sentence that
+  // fails to normalize is reported with an empty output.
+  typedef std::function<void(const string &output)> Callback;
+
+  static const size_t kDefaultMaxBufferSize = 1 << 16;
+
+  StreamingNormalizer(std::shared_ptr<const NormalizerModel> model,
+                      Callback callback);
+
+  ~StreamingNormalizer();
+
+  // Adds text to the input, and normalizes any sentences it completes.
+  void Feed(const string &text);
+
+  // Normalizes the remaining input as the last sentence. The normalizer can
+  // then be fed a new text.
+  void Flush();
+
+  // Sets how much unfinished input to hold before forcing a cut. Defaults to
+  // kDefaultMaxBufferSize.
+  void set_max_buffer_size(size_t max_buffer_size) {
+    max_buffer_size_ = max_buffer_size;
+  }
+
+ private:
+  // Normalizes sentence, unless it is only whitespace, and passes on the
+  // result.
+  void Emit(const string &sentence);
+
+  std::shared_ptr<const NormalizerModel> model_;
+  Callback callback_;
+  NormalizerSession session_;
+  // Input since the last sentence boundary.
+  string buffer_;
+  size_t max_buffer_size_;
+  string output_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingNormalizer);
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_STREAMING_NORMALIZER_H_
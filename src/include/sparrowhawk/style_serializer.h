@@ -27,7 +27,10 @@
 #ifndef SPARROWHAWK_STYLE_SERIALIZER_H_
 #define SPARROWHAWK_STYLE_SERIALIZER_H_
 
+#include <map>
 #include <memory>
+#include <string>
+using std::string;
 #include <vector>
 using std::vector;
 
@@ -36,26 +39,58 @@ using std::vector;
 #include <thrax/grm-manager.h>
 #include <sparrowhawk/items.pb.h>
 #include <sparrowhawk/serialization_spec.pb.h>
-#include <sparrowhawk/field_path.h>
+#include <sparrowhawk/field_trie.h>
 #include <sparrowhawk/record_serializer.h>
 
 namespace speech {
 namespace sparrowhawk {
 
+// The distinct field paths named as required or prohibited by the styles of a
+// class, each with a bit in the presence of a token, so that a token's fields
+// are looked up once for all of the styles.
+class FieldPresence {
+ public:
+  // One bit per path, set if the field at the end of the path is set.
+  typedef std::vector<uint64> Bits;
+
+  // Returns the bit of the path given by path_string, adding it to trie and
+  // to this if it is new, or -1 if the path does not parse.
+  int AddPath(const string &path_string, FieldTrie *trie);
+
+  // Fills presence with the bits of the paths set in the token read by
+  // messages, which belongs to the trie the paths were added to.
+  void Compute(FieldTrie::Messages *messages, Bits *presence) const;
+
+  int num_paths() const { return paths_.size(); }
+
+ private:
+  // Indexed by bit.
+  std::vector<FieldTrie::Field> paths_;
+  std::map<string, int> bits_;
+};
+
 class StyleSerializer {
  public:
   typedef fst::StdVectorFst MutableTransducer;
 
   // Creates and returns a StyleSerializer from the style_spec by creating
-  // record_serializers for all its record_specs and storing field_paths of
-  // required and prohibited fields.
+  // record_serializers for all its record_specs and compiling its required
+  // and prohibited fields into masks over the bits of presence, which is
+  // shared by the styles of the class. The field paths are added to trie.
   // Returns a null value if the spec is not well-formed.
-  static std::unique_ptr<StyleSerializer> Create(const StyleSpec &style_spec);
+  static std::unique_ptr<StyleSerializer> Create(const StyleSpec &style_spec,
+                                                 FieldTrie *trie,
+                                                 FieldPresence *presence);
 
   // Serializes a token using the style spec, returns true only for valid
   // styles satisfying required/prohibited field constraints. If so, all the
-  // records in the style are serialized onto the input fst.
-  bool Serialize(const Token &token, MutableTransducer *serialization) const;
+  // records in the style are serialized onto the input fst. presence is the
+  // FieldPresence passed to Create() computed for the token, and messages
+  // reads the token through the trie passed to Create().
+  bool Serialize(const Token &token,
+                 const FieldPresence::Bits &presence,
+                 FieldTrie::Messages *messages,
+                 MutableTransducer *serialization) const;
 
  private:
   // Only used by the factory function Create.
@@ -63,38 +98,37 @@ class StyleSerializer {
 
   // Populates record_serializers_ using style_spec.
   static bool CreateRecordSerializers(const StyleSpec &style_spec,
+      FieldTrie *trie,
       const std::unique_ptr<StyleSerializer> &style_serializer);
 
-  // Populates required_fields_ using style_spec.
-  static bool SetRequiredFieldPaths(const StyleSpec &style_spec,
+  // Populates required_all_ and required_any_ using style_spec.
+  static bool SetRequiredFieldMasks(const StyleSpec &style_spec,
+      FieldTrie *trie, FieldPresence *presence,
       const std::unique_ptr<StyleSerializer> &style_serializer);
 
-  // Populates prohibited_fields_ using style_spec.
-  static bool SetProhibitedFieldPaths(const StyleSpec &style_spec,
+  // Populates prohibited_ using style_spec.
+  static bool SetProhibitedFieldMask(const StyleSpec &style_spec,
+      FieldTrie *trie, FieldPresence *presence,
       const std::unique_ptr<StyleSerializer> &style_serializer);
 
-  // Checks required_fields_ in token.
-  bool CheckRequiredFields(const Token &token) const;
+  // Sets the given bit in mask, growing it as needed.
+  static void SetBit(int bit, FieldPresence::Bits *mask);
 
-  // Checks prohibited_fields_ in token.
-  bool CheckProhibitedFields(const Token &token) const;
+  // Checks the required and prohibited fields against presence.
+  bool CheckFields(const FieldPresence::Bits &presence) const;
 
-  // FieldPaths to required fields in the specification.
-  std::vector<std::vector<FieldPath>> required_fields_;
+  // Required fields without alternatives, all of which must be set.
+  FieldPresence::Bits required_all_;
 
-  // FieldPaths to prohibited fields in the specification.
-  std::vector<FieldPath> prohibited_fields_;
+  // Required fields with alternatives, one of each of which must be set.
+  std::vector<FieldPresence::Bits> required_any_;
+
+  // Prohibited fields, none of which may be set.
+  FieldPresence::Bits prohibited_;
 
   // Record serializers for the record specs in the style.
   std::vector<std::unique_ptr<RecordSerializer>> record_serializers_;
 
-  // Takes as input a message and a target field path ending in a scalar field
-  // to within the input message and returns true if the field at the end of the
-  // path is set. It further assumes that all the intermediate messages are
-  // non-repeated, although the terminating field itself may be repeated.
-  bool IsFieldSet(const google::protobuf::Message &root,
-                  const FieldPath &field_path) const;
-
   DISALLOW_COPY_AND_ASSIGN(StyleSerializer);
 };
 
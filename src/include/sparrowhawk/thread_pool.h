@@ -0,0 +1,72 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// A simple fixed-size pool of worker threads.
+//
+// Work is handed out from a shared queue, and ParallelFor() lets idle workers
+// (and the calling thread) pull the next unclaimed index as soon as they are
+// done with the previous one, so uneven work items balance themselves out
+// across the pool.
+
+#ifndef SPARROWHAWK_THREAD_POOL_H_
+#define SPARROWHAWK_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include <fst/compat.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+class ThreadPool {
+ public:
+  // Starts num_threads worker threads. A pool with no threads is valid: in
+  // that case all the work is done on the calling thread.
+  explicit ThreadPool(int num_threads);
+
+  // Waits for all scheduled work to finish and joins the workers.
+  ~ThreadPool();
+
+  // Queues a task to be run on one of the worker threads.
+  void Schedule(std::function<void()> task);
+
+  // Calls fn(i) for each i in [0, n) and returns once all calls have
+  // finished. The calling thread takes part in the work, so this is safe to
+  // call with a pool whose workers are all busy.
+  void ParallelFor(int n, const std::function<void(int)> &fn);
+
+  int num_threads() const { return workers_.size(); }
+
+ private:
+  // Main loop for each worker thread.
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+#endif  // SPARROWHAWK_THREAD_POOL_H_
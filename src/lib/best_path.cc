@@ -0,0 +1,197 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/best_path.h>
+
+#include <limits>
+#include <memory>
+#include <vector>
+using std::vector;
+
+namespace speech {
+namespace sparrowhawk {
+
+typedef fst::StdArc Arc;
+typedef Arc::StateId StateId;
+typedef fst::Fst<Arc> Transducer;
+typedef fst::ArcIterator<Transducer> ArcIterator;
+
+namespace {
+
+enum VisitState { kUnvisited = 0, kOnStack, kDone };
+
+// What the search knows about a state once it is done with it: the cost of
+// its best path to a final state, and the first arc of that path, if it does
+// not just stop there.
+struct BestArc {
+  float cost;
+  StateId nextstate;
+  Arc::Label ilabel;
+  Arc::Label olabel;
+};
+
+}  // namespace
+
+bool BestPath(const Transducer &fst,
+              int64 max_states,
+              int64 max_arcs,
+              LabelPath *path,
+              int64 *num_states,
+              int64 *num_arcs) {
+  path->clear();
+  // The counts are needed for the limits even if the caller does not want
+  // them.
+  int64 unused_num_states, unused_num_arcs;
+  if (num_states == nullptr) num_states = &unused_num_states;
+  if (num_arcs == nullptr) num_arcs = &unused_num_arcs;
+  *num_states = 0;
+  *num_arcs = 0;
+  const StateId start = fst.Start();
+  if (start == fst::kNoStateId) return false;
+  // Indexed by state id, and grown as new states turn up.
+  std::vector<char> visit_state;
+  std::vector<BestArc> best;
+  // A state's best path is only known once all of its successors are done, so
+  // this works out the best paths in depth-first post-order. An arc to a state
+  // that has not been visited yet is left where it is until that state is
+  // done.
+  struct Frame {
+    StateId state;
+    std::unique_ptr<ArcIterator> aiter;
+  };
+  std::vector<Frame> stack;
+  auto visit = [&](StateId state) {
+    if (state >= visit_state.size()) {
+      visit_state.resize(state + 1, kUnvisited);
+      best.resize(state + 1);
+    }
+    visit_state[state] = kOnStack;
+    BestArc &best_arc = best[state];
+    best_arc.cost = fst.Final(state).Value();
+    best_arc.nextstate = fst::kNoStateId;
+    stack.push_back(Frame());
+    stack.back().state = state;
+    stack.back().aiter.reset(new ArcIterator(fst, state));
+    ++*num_states;
+  };
+  visit(start);
+  while (!stack.empty()) {
+    Frame &frame = stack.back();
+    if (frame.aiter->Done()) {
+      visit_state[frame.state] = kDone;
+      stack.pop_back();
+      continue;
+    }
+    const Arc &arc = frame.aiter->Value();
+    if (arc.nextstate >= visit_state.size() ||
+        visit_state[arc.nextstate] == kUnvisited) {
+      visit(arc.nextstate);
+      if (max_states > 0 && *num_states > max_states) return false;
+      continue;
+    }
+    if (visit_state[arc.nextstate] == kOnStack) {
+      // A cycle, so post-order is not a topological order. The lattice is
+      // expanded within the same limits for fst::ShortestPath().
+      stack.clear();
+      fst::VectorFst<Arc> lattice;
+      if (!CopyWithinLimits(fst, max_states, max_arcs, &lattice)) return false;
+      *num_states = lattice.NumStates();
+      *num_arcs = 0;
+      for (StateId state = 0; state < lattice.NumStates(); ++state) {
+        *num_arcs += lattice.NumArcs(state);
+      }
+      fst::VectorFst<Arc> shortest_path;
+      fst::ShortestPath(lattice, &shortest_path);
+      GetPathLabels(shortest_path, path);
+      return shortest_path.Start() != fst::kNoStateId;
+    }
+    ++*num_arcs;
+    if (max_arcs > 0 && *num_arcs > max_arcs) return false;
+    const float cost = arc.weight.Value() + best[arc.nextstate].cost;
+    BestArc &best_arc = best[frame.state];
+    if (cost < best_arc.cost) {
+      best_arc.cost = cost;
+      best_arc.nextstate = arc.nextstate;
+      best_arc.ilabel = arc.ilabel;
+      best_arc.olabel = arc.olabel;
+    }
+    frame.aiter->Next();
+  }
+  if (best[start].cost == std::numeric_limits<float>::infinity()) {
+    return false;
+  }
+  for (StateId state = start; best[state].nextstate != fst::kNoStateId;
+       state = best[state].nextstate) {
+    const BestArc &best_arc = best[state];
+    if (best_arc.ilabel != 0 || best_arc.olabel != 0) {
+      path->push_back(std::make_pair(best_arc.ilabel, best_arc.olabel));
+    }
+  }
+  return true;
+}
+
+bool CopyWithinLimits(const Transducer &fst,
+                      int64 max_states,
+                      int64 max_arcs,
+                      fst::MutableFst<Arc> *output) {
+  output->DeleteStates();
+  output->SetInputSymbols(fst.InputSymbols());
+  output->SetOutputSymbols(fst.OutputSymbols());
+  if (fst.Start() == fst::kNoStateId) return true;
+  // Maps the states of fst to those of output.
+  std::vector<StateId> state_map;
+  std::vector<StateId> queue;
+  auto find_state = [&](StateId state) {
+    if (state >= state_map.size()) {
+      state_map.resize(state + 1, fst::kNoStateId);
+    }
+    if (state_map[state] == fst::kNoStateId) {
+      state_map[state] = output->AddState();
+      queue.push_back(state);
+    }
+    return state_map[state];
+  };
+  output->SetStart(find_state(fst.Start()));
+  int64 num_arcs = 0;
+  while (!queue.empty()) {
+    if (max_states > 0 && output->NumStates() > max_states) return false;
+    const StateId state = queue.back();
+    queue.pop_back();
+    const StateId output_state = state_map[state];
+    output->SetFinal(output_state, fst.Final(state));
+    for (ArcIterator aiter(fst, state); !aiter.Done(); aiter.Next()) {
+      if (max_arcs > 0 && ++num_arcs > max_arcs) return false;
+      Arc arc = aiter.Value();
+      arc.nextstate = find_state(arc.nextstate);
+      output->AddArc(output_state, arc);
+    }
+  }
+  return true;
+}
+
+void GetPathLabels(const Transducer &fst, LabelPath *path) {
+  path->clear();
+  if (fst.Start() == fst::kNoStateId) return;
+  for (StateId state = fst.Start(); ; ) {
+    ArcIterator aiter(fst, state);
+    if (aiter.Done()) break;
+    const Arc &arc = aiter.Value();
+    if (arc.ilabel != 0 || arc.olabel != 0) {
+      path->push_back(std::make_pair(arc.ilabel, arc.olabel));
+    }
+    state = arc.nextstate;
+  }
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
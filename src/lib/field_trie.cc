@@ -0,0 +1,93 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/field_trie.h>
+
+#include <memory>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <sparrowhawk/field_path.h>
+#include <sparrowhawk/message_fields.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+const int FieldTrie::kRoot;
+
+FieldTrie::FieldTrie(const Descriptor *root_type) : root_type_(root_type) {
+  nodes_.push_back(Node{kRoot, nullptr, FindMessageFields(root_type)});
+}
+
+bool FieldTrie::AddPath(const string &path_string, Field *field) {
+  std::unique_ptr<FieldPath> field_path = FieldPath::Create(root_type_);
+  if (field_path == nullptr || !field_path->Parse(path_string)) return false;
+  int node = kRoot;
+  for (int i = 0; i < field_path->GetLength() - 1; ++i) {
+    const FieldDescriptor *child_field = field_path->GetField(i);
+    auto inserted = children_.insert(
+        std::make_pair(std::make_pair(node, child_field), nodes_.size()));
+    if (inserted.second) {
+      nodes_.push_back(Node{node, child_field,
+                            FindMessageFields(child_field->message_type())});
+    }
+    node = inserted.first->second;
+  }
+  field->parent = node;
+  field->descriptor = field_path->GetField(field_path->GetLength() - 1);
+  return true;
+}
+
+FieldTrie::Messages::Messages(const FieldTrie &trie, const Message &root)
+    : trie_(trie), messages_(trie.nodes_.size(), nullptr) {
+  messages_[kRoot] = &root;
+}
+
+const FieldTrie::Message &FieldTrie::Messages::Get(int node) {
+  if (messages_[node] == nullptr) {
+    const Node &trie_node = trie_.nodes_[node];
+    const Message &parent = Get(trie_node.parent);
+    const MessageFields *parent_fields = trie_.nodes_[trie_node.parent].fields;
+    if (parent_fields != nullptr) {
+      messages_[node] = &parent_fields->GetMessage(parent, trie_node.field, 0);
+    } else {
+      messages_[node] =
+          &parent.GetReflection()->GetMessage(parent, trie_node.field);
+    }
+  }
+  return *messages_[node];
+}
+
+bool FieldTrie::Messages::IsSet(const Field &field) {
+  if (field.descriptor->label() == FieldDescriptor::LABEL_REPEATED) {
+    return FieldSize(field) > 0;
+  }
+  const Message &parent = Get(field.parent);
+  return parent.GetReflection()->HasField(parent, field.descriptor);
+}
+
+int FieldTrie::Messages::FieldSize(const Field &field) {
+  const Message &parent = Get(field.parent);
+  const MessageFields *parent_fields = trie_.nodes_[field.parent].fields;
+  if (parent_fields != nullptr) {
+    return parent_fields->FieldSize(parent, field.descriptor);
+  }
+  return parent.GetReflection()->FieldSize(parent, field.descriptor);
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
@@ -13,6 +13,8 @@
 // Copyright 2015 and onwards Google, Inc.
 #include <sparrowhawk/io_utils.h>
 
+#include <sys/stat.h>
+
 #include <iostream>
 #include <fstream>
 using std::ifstream;
@@ -41,5 +43,45 @@ string IOStream::LoadFileToString(const string &filename) {
   return string(data.get(), length);
 }
 
+bool IOStream::FingerprintFile(const string &filename, uint64 *fingerprint) {
+  std::ifstream strm(filename.c_str(),
+                     std::ios_base::in | std::ios_base::binary);
+  if (!strm) {
+    LoggerError("Error opening file %s", filename.c_str());
+    return false;
+  }
+  // 64-bit FNV-1a.
+  const uint64 kPrime = 1099511628211ULL;
+  uint64 hash = 14695981039346656037ULL;
+  const int kBufferSize = 1 << 16;
+  std::unique_ptr<char[]> buffer(new char[kBufferSize],
+                                 std::default_delete<char[]>());
+  while (strm) {
+    strm.read(buffer.get(), kBufferSize);
+    const std::streamsize count = strm.gcount();
+    for (std::streamsize i = 0; i < count; ++i) {
+      hash ^= static_cast<unsigned char>(buffer.get()[i]);
+      hash *= kPrime;
+    }
+  }
+  if (strm.bad()) {
+    LoggerError("Error reading from file %s", filename.c_str());
+    return false;
+  }
+  *fingerprint = hash;
+  return true;
+}
+
+bool IOStream::StatFile(const string &filename, int64 *size, int64 *mtime) {
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) {
+    LoggerError("Error opening file %s", filename.c_str());
+    return false;
+  }
+  *size = file_stat.st_size;
+  *mtime = file_stat.st_mtime;
+  return true;
+}
+
 }  // namespace sparrowhawk
 }  // namespace speech
@@ -0,0 +1,759 @@
+// Generated by protoc-gen-sparrowhawk from items.proto. DO NOT EDIT.
+
+#include <sparrowhawk/items.fields.h>
+
+#include <cstdio>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <sparrowhawk/items.pb.h>
+#include <sparrowhawk/logger.h>
+#include <sparrowhawk/message_fields.h>
+
+// Deprecated fields are still parsed and serialized.
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+namespace speech {
+namespace sparrowhawk {
+
+namespace {
+
+using ::speech::sparrowhawk::AppendFieldValue;
+using ::speech::sparrowhawk::FieldName;
+using ::speech::sparrowhawk::FindFieldIndex;
+using ::speech::sparrowhawk::MessageFields;
+using ::speech::sparrowhawk::ParseFieldValue;
+
+typedef google::protobuf::FieldDescriptor FieldDescriptor;
+typedef google::protobuf::Message Message;
+
+class TokenFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"abbreviation", 28},
+      {"cardinal", 13},
+      {"connector", 27},
+      {"date", 21},
+      {"decimal", 16},
+      {"digit", 15},
+      {"electronic", 24},
+      {"end_index", 2},
+      {"first_daughter", 29},
+      {"fraction", 17},
+      {"last_daughter", 30},
+      {"letters", 26},
+      {"links", 0},
+      {"measure", 19},
+      {"money", 23},
+      {"name", 3},
+      {"next_space", 12},
+      {"ordinal", 14},
+      {"pause_duration", 8},
+      {"pause_length", 9},
+      {"percent", 20},
+      {"phrase_break", 7},
+      {"skip", 11},
+      {"spelling", 6},
+      {"spelling_with_stress", 10},
+      {"start_index", 1},
+      {"telephone", 22},
+      {"time", 18},
+      {"type", 4},
+      {"verbatim", 25},
+      {"wordid", 5},
+    };
+    const int index =
+        FindFieldIndex(kNames, 31, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Token::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    message.GetReflection()->ListFields(message, fields);
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    return message.GetReflection()->FieldSize(message, field);
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    const ::speech::sparrowhawk::Token &m =
+        static_cast<const ::speech::sparrowhawk::Token &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.links();
+      case 14:
+        return m.cardinal();
+      case 15:
+        return m.ordinal();
+      case 17:
+        return m.decimal();
+      case 18:
+        return m.fraction();
+      case 19:
+        return m.time();
+      case 20:
+        return m.measure();
+      case 21:
+        return m.percent();
+      case 22:
+        return m.date();
+      case 23:
+        return m.telephone();
+      case 24:
+        return m.money();
+      case 25:
+        return m.electronic();
+      case 28:
+        return m.connector();
+      case 29:
+        return m.abbreviation();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedMessage(message, field,
+                                                        index) :
+            message.GetReflection()->GetMessage(message, field);
+    }
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Token &m =
+        static_cast<const ::speech::sparrowhawk::Token &>(message);
+    switch (field->number()) {
+      case 4:
+        return m.name();
+      case 6:
+        return m.wordid();
+      case 7:
+        return m.spelling();
+      case 11:
+        return m.spelling_with_stress();
+      case 16:
+        return m.digit();
+      case 26:
+        return m.verbatim();
+      case 27:
+        return m.letters();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Token &m =
+        static_cast<const ::speech::sparrowhawk::Token &>(message);
+    switch (field->number()) {
+      case 2:
+        AppendFieldValue(static_cast<uint32>(m.start_index()), text);
+        return true;
+      case 3:
+        AppendFieldValue(static_cast<uint32>(m.end_index()), text);
+        return true;
+      case 5:
+        text->append(::speech::sparrowhawk::Token_Type_Name(
+            m.type()));
+        return true;
+      case 8:
+        AppendFieldValue(static_cast<bool>(m.phrase_break()), text);
+        return true;
+      case 10:
+        text->append(::speech::sparrowhawk::Token_PauseLength_Name(
+            m.pause_length()));
+        return true;
+      case 12:
+        AppendFieldValue(static_cast<bool>(m.skip()), text);
+        return true;
+      case 13:
+        AppendFieldValue(static_cast<bool>(m.next_space()), text);
+        return true;
+      case 30:
+        AppendFieldValue(static_cast<int32>(m.first_daughter()), text);
+        return true;
+      case 31:
+        AppendFieldValue(static_cast<int32>(m.last_daughter()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    ::speech::sparrowhawk::Token *m = static_cast<::speech::sparrowhawk::Token *>(message);
+    switch (field->number()) {
+      case 1:
+        return m->mutable_links();
+      case 14:
+        return m->mutable_cardinal();
+      case 15:
+        return m->mutable_ordinal();
+      case 17:
+        return m->mutable_decimal();
+      case 18:
+        return m->mutable_fraction();
+      case 19:
+        return m->mutable_time();
+      case 20:
+        return m->mutable_measure();
+      case 21:
+        return m->mutable_percent();
+      case 22:
+        return m->mutable_date();
+      case 23:
+        return m->mutable_telephone();
+      case 24:
+        return m->mutable_money();
+      case 25:
+        return m->mutable_electronic();
+      case 28:
+        return m->mutable_connector();
+      case 29:
+        return m->mutable_abbreviation();
+      default:
+        return field->is_repeated() ?
+            message->GetReflection()->AddMessage(message, field) :
+            message->GetReflection()->MutableMessage(message, field);
+    }
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Token *m = static_cast<::speech::sparrowhawk::Token *>(message);
+    switch (field->number()) {
+      case 2: {
+        uint32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_start_index(parsed);
+        }
+        return true;
+      }
+      case 3: {
+        uint32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_end_index(parsed);
+        }
+        return true;
+      }
+      case 4:
+        m->set_name(value);
+        return true;
+      case 5: {
+        ::speech::sparrowhawk::Token_Type parsed;
+        if (::speech::sparrowhawk::Token_Type_Parse(value, &parsed)) {
+          m->set_type(parsed);
+        } else {
+          LoggerError("Unknown enumeration value %s", value.c_str());
+        }
+        return true;
+      }
+      case 6:
+        m->set_wordid(value);
+        return true;
+      case 7:
+        m->set_spelling(value);
+        return true;
+      case 8: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_phrase_break(parsed);
+        }
+        return true;
+      }
+      case 9: {
+        float parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_pause_duration(parsed);
+        }
+        return true;
+      }
+      case 10: {
+        ::speech::sparrowhawk::Token_PauseLength parsed;
+        if (::speech::sparrowhawk::Token_PauseLength_Parse(value, &parsed)) {
+          m->set_pause_length(parsed);
+        } else {
+          LoggerError("Unknown enumeration value %s", value.c_str());
+        }
+        return true;
+      }
+      case 11:
+        m->set_spelling_with_stress(value);
+        return true;
+      case 12: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_skip(parsed);
+        }
+        return true;
+      }
+      case 13: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_next_space(parsed);
+        }
+        return true;
+      }
+      case 16:
+        m->set_digit(value);
+        return true;
+      case 26:
+        m->set_verbatim(value);
+        return true;
+      case 27:
+        m->set_letters(value);
+        return true;
+      case 30: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_first_daughter(parsed);
+        }
+        return true;
+      }
+      case 31: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_last_daughter(parsed);
+        }
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+};
+
+class WordFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"id", 1},
+      {"links", 0},
+      {"parent", 5},
+      {"pause_length", 3},
+      {"precedes_pause", 4},
+      {"spelling", 2},
+    };
+    const int index =
+        FindFieldIndex(kNames, 6, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Word::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    message.GetReflection()->ListFields(message, fields);
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    return message.GetReflection()->FieldSize(message, field);
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    const ::speech::sparrowhawk::Word &m =
+        static_cast<const ::speech::sparrowhawk::Word &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.links();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedMessage(message, field,
+                                                        index) :
+            message.GetReflection()->GetMessage(message, field);
+    }
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Word &m =
+        static_cast<const ::speech::sparrowhawk::Word &>(message);
+    switch (field->number()) {
+      case 2:
+        return m.id();
+      case 3:
+        return m.spelling();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Word &m =
+        static_cast<const ::speech::sparrowhawk::Word &>(message);
+    switch (field->number()) {
+      case 5:
+        AppendFieldValue(static_cast<bool>(m.precedes_pause()), text);
+        return true;
+      case 6:
+        AppendFieldValue(static_cast<int32>(m.parent()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    ::speech::sparrowhawk::Word *m = static_cast<::speech::sparrowhawk::Word *>(message);
+    switch (field->number()) {
+      case 1:
+        return m->mutable_links();
+      default:
+        return field->is_repeated() ?
+            message->GetReflection()->AddMessage(message, field) :
+            message->GetReflection()->MutableMessage(message, field);
+    }
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Word *m = static_cast<::speech::sparrowhawk::Word *>(message);
+    switch (field->number()) {
+      case 2:
+        m->set_id(value);
+        return true;
+      case 3:
+        m->set_spelling(value);
+        return true;
+      case 4: {
+        float parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_pause_length(parsed);
+        }
+        return true;
+      }
+      case 5: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_precedes_pause(parsed);
+        }
+        return true;
+      }
+      case 6: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_parent(parsed);
+        }
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+};
+
+class LinguisticStructureFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"id", 0},
+      {"input", 1},
+      {"tokens", 2},
+      {"words", 3},
+    };
+    const int index =
+        FindFieldIndex(kNames, 4, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::LinguisticStructure::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    message.GetReflection()->ListFields(message, fields);
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::LinguisticStructure &m =
+        static_cast<const ::speech::sparrowhawk::LinguisticStructure &>(message);
+    switch (field->number()) {
+      case 3:
+        return m.tokens_size();
+      case 4:
+        return m.words_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    const ::speech::sparrowhawk::LinguisticStructure &m =
+        static_cast<const ::speech::sparrowhawk::LinguisticStructure &>(message);
+    switch (field->number()) {
+      case 3:
+        return m.tokens(index);
+      case 4:
+        return m.words(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedMessage(message, field,
+                                                        index) :
+            message.GetReflection()->GetMessage(message, field);
+    }
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::LinguisticStructure &m =
+        static_cast<const ::speech::sparrowhawk::LinguisticStructure &>(message);
+    switch (field->number()) {
+      case 2:
+        return m.input();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::LinguisticStructure &m =
+        static_cast<const ::speech::sparrowhawk::LinguisticStructure &>(message);
+    switch (field->number()) {
+      case 1:
+        AppendFieldValue(static_cast<int64>(m.id()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    ::speech::sparrowhawk::LinguisticStructure *m = static_cast<::speech::sparrowhawk::LinguisticStructure *>(message);
+    switch (field->number()) {
+      case 3:
+        return m->add_tokens();
+      case 4:
+        return m->add_words();
+      default:
+        return field->is_repeated() ?
+            message->GetReflection()->AddMessage(message, field) :
+            message->GetReflection()->MutableMessage(message, field);
+    }
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::LinguisticStructure *m = static_cast<::speech::sparrowhawk::LinguisticStructure *>(message);
+    switch (field->number()) {
+      case 1: {
+        int64 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_id(parsed);
+        }
+        return true;
+      }
+      case 2:
+        m->set_input(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class UtteranceFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"filename", 1},
+      {"id", 0},
+      {"linguistic", 5},
+      {"original_sentence", 3},
+      {"segmenter_output", 4},
+      {"sentence", 2},
+    };
+    const int index =
+        FindFieldIndex(kNames, 6, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Utterance::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    message.GetReflection()->ListFields(message, fields);
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Utterance &m =
+        static_cast<const ::speech::sparrowhawk::Utterance &>(message);
+    switch (field->number()) {
+      case 5:
+        return m.segmenter_output_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    const ::speech::sparrowhawk::Utterance &m =
+        static_cast<const ::speech::sparrowhawk::Utterance &>(message);
+    switch (field->number()) {
+      case 6:
+        return m.linguistic();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedMessage(message, field,
+                                                        index) :
+            message.GetReflection()->GetMessage(message, field);
+    }
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Utterance &m =
+        static_cast<const ::speech::sparrowhawk::Utterance &>(message);
+    switch (field->number()) {
+      case 2:
+        return m.filename();
+      case 3:
+        return m.sentence();
+      case 4:
+        return m.original_sentence();
+      case 5:
+        return m.segmenter_output(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Utterance &m =
+        static_cast<const ::speech::sparrowhawk::Utterance &>(message);
+    switch (field->number()) {
+      case 1:
+        AppendFieldValue(static_cast<uint64>(m.id()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    ::speech::sparrowhawk::Utterance *m = static_cast<::speech::sparrowhawk::Utterance *>(message);
+    switch (field->number()) {
+      case 6:
+        return m->mutable_linguistic();
+      default:
+        return field->is_repeated() ?
+            message->GetReflection()->AddMessage(message, field) :
+            message->GetReflection()->MutableMessage(message, field);
+    }
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Utterance *m = static_cast<::speech::sparrowhawk::Utterance *>(message);
+    switch (field->number()) {
+      case 1: {
+        uint64 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_id(parsed);
+        }
+        return true;
+      }
+      case 2:
+        m->set_filename(value);
+        return true;
+      case 3:
+        m->set_sentence(value);
+        return true;
+      case 4:
+        m->set_original_sentence(value);
+        return true;
+      case 5:
+        m->add_segmenter_output(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+}  // namespace
+
+void RegisterItemsMessageFields() {
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Token::descriptor(),
+      new TokenFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Word::descriptor(),
+      new WordFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::LinguisticStructure::descriptor(),
+      new LinguisticStructureFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Utterance::descriptor(),
+      new UtteranceFields);
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
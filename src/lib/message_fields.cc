@@ -0,0 +1,159 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/message_fields.h>
+
+#include <string.h>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <string>
+using std::string;
+#include <unordered_map>
+
+#include <sparrowhawk/items.fields.h>
+#include <sparrowhawk/logger.h>
+#include <sparrowhawk/numbers.h>
+#include <sparrowhawk/semiotic_classes.fields.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+using google::protobuf::Descriptor;
+
+namespace {
+
+typedef std::unordered_map<const Descriptor *, const MessageFields *>
+    MessageFieldsMap;
+
+// Only written while the generated code registers itself, which happens once
+// before the first lookup, so lookups need no lock.
+MessageFieldsMap *GetMessageFieldsMap() {
+  static MessageFieldsMap *message_fields = new MessageFieldsMap;
+  return message_fields;
+}
+
+void RegisterAllMessageFields() {
+  RegisterItemsMessageFields();
+  RegisterSemioticClassesMessageFields();
+}
+
+}  // namespace
+
+const MessageFields *FindMessageFields(const Descriptor *descriptor) {
+  static std::once_flag registered;
+  std::call_once(registered, RegisterAllMessageFields);
+  const MessageFieldsMap &message_fields = *GetMessageFieldsMap();
+  auto it = message_fields.find(descriptor);
+  return it == message_fields.end() ? NULL : it->second;
+}
+
+void RegisterMessageFields(const Descriptor *descriptor,
+                           const MessageFields *fields) {
+  (*GetMessageFieldsMap())[descriptor] = fields;
+}
+
+int FindFieldIndex(const FieldName *names, int num_names, const string &name) {
+  int low = 0;
+  int high = num_names;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    const int compare = strcmp(names[middle].name, name.c_str());
+    if (compare == 0) return names[middle].index;
+    if (compare < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return -1;
+}
+
+bool ParseFieldValue(const string &text, bool *value) {
+  *value = text == "true";
+  return true;
+}
+
+bool ParseFieldValue(const string &text, int32 *value) {
+  if (safe_strto32(text, value)) return true;
+  LoggerError("Unable to convert string to int32.");
+  return false;
+}
+
+bool ParseFieldValue(const string &text, int64 *value) {
+  if (safe_strto64(text, value)) return true;
+  LoggerError("Unable to convert string to int64.");
+  return false;
+}
+
+bool ParseFieldValue(const string &text, uint32 *value) {
+  int64 value_int64;
+  if (safe_strto64(text, &value_int64) && value_int64 >= 0 &&
+      value_int64 <= std::numeric_limits<uint32>::max()) {
+    *value = value_int64;
+    return true;
+  }
+  LoggerError("Unable to convert string to uint32.");
+  return false;
+}
+
+bool ParseFieldValue(const string &text, uint64 *value) {
+  int64 value_int64;
+  if (safe_strto64(text, &value_int64) && value_int64 >= 0) {
+    *value = value_int64;
+    return true;
+  }
+  LoggerError("Unable to convert string to uint64.");
+  return false;
+}
+
+bool ParseFieldValue(const string &text, float *value) {
+  if (safe_strtof(text, value)) return true;
+  LoggerError("Unable to convert string to float.");
+  return false;
+}
+
+bool ParseFieldValue(const string &text, double *value) {
+  if (safe_strtod(text, value)) return true;
+  LoggerError("Unable to convert string to double.");
+  return false;
+}
+
+void AppendFieldValue(bool value, string *text) {
+  text->append(value ? "true" : "false");
+}
+
+void AppendFieldValue(int32 value, string *text) {
+  char number[24];
+  text->append(number, snprintf(number, sizeof(number), "%d", value));
+}
+
+void AppendFieldValue(int64 value, string *text) {
+  char number[24];
+  text->append(number, snprintf(number, sizeof(number), "%lld",
+                                static_cast<long long>(value)));
+}
+
+void AppendFieldValue(uint32 value, string *text) {
+  char number[24];
+  text->append(number, snprintf(number, sizeof(number), "%u", value));
+}
+
+void AppendFieldValue(uint64 value, string *text) {
+  char number[24];
+  text->append(number, snprintf(number, sizeof(number), "%llu",
+                                static_cast<unsigned long long>(value)));
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
@@ -0,0 +1,124 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/normalize_stats.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+using std::string;
+
+namespace speech {
+namespace sparrowhawk {
+
+void NormalizeStats::Clear() {
+  num_sentences = 0;
+  num_sentence_cache_hits = 0;
+  tokenizer_usec = 0;
+  parse_usec = 0;
+  serialization_usec = 0;
+  verbalizer_usec = 0;
+  num_verbalizer_calls = 0;
+  verbalizer_call_usec.clear();
+  tokenizer_output_states = 0;
+  tokenizer_output_arcs = 0;
+  best_path_length = 0;
+  tokens_per_class.clear();
+  num_verbalization_cache_hits = 0;
+  num_verbatim_fallbacks = 0;
+}
+
+void NormalizeStats::Add(const NormalizeStats &other) {
+  num_sentences += other.num_sentences;
+  num_sentence_cache_hits += other.num_sentence_cache_hits;
+  tokenizer_usec += other.tokenizer_usec;
+  parse_usec += other.parse_usec;
+  serialization_usec += other.serialization_usec;
+  verbalizer_usec += other.verbalizer_usec;
+  num_verbalizer_calls += other.num_verbalizer_calls;
+  verbalizer_call_usec.insert(verbalizer_call_usec.end(),
+                              other.verbalizer_call_usec.begin(),
+                              other.verbalizer_call_usec.end());
+  tokenizer_output_states += other.tokenizer_output_states;
+  tokenizer_output_arcs += other.tokenizer_output_arcs;
+  best_path_length += other.best_path_length;
+  for (const auto &count : other.tokens_per_class) {
+    tokens_per_class[count.first] += count.second;
+  }
+  num_verbalization_cache_hits += other.num_verbalization_cache_hits;
+  num_verbatim_fallbacks += other.num_verbatim_fallbacks;
+}
+
+string NormalizeStats::ToString() const {
+  string output;
+  auto append = [&output](const string &name, int64 value) {
+    output.append(name + "\t" + std::to_string(value) + "\n");
+  };
+  append("num_sentences", num_sentences);
+  append("num_sentence_cache_hits", num_sentence_cache_hits);
+  append("tokenizer_usec", tokenizer_usec);
+  append("parse_usec", parse_usec);
+  append("serialization_usec", serialization_usec);
+  append("verbalizer_usec", verbalizer_usec);
+  append("num_verbalizer_calls", num_verbalizer_calls);
+  append("tokenizer_output_states", tokenizer_output_states);
+  append("tokenizer_output_arcs", tokenizer_output_arcs);
+  append("best_path_length", best_path_length);
+  for (const auto &count : tokens_per_class) {
+    append("tokens[" + count.first + "]", count.second);
+  }
+  append("num_verbalization_cache_hits", num_verbalization_cache_hits);
+  append("num_verbatim_fallbacks", num_verbatim_fallbacks);
+  return output;
+}
+
+namespace {
+
+std::atomic<bool> global_stats_enabled(false);
+std::mutex global_stats_mutex;
+
+NormalizeStats *GlobalStats() {
+  static NormalizeStats *stats = new NormalizeStats;
+  return stats;
+}
+
+}  // namespace
+
+void SetGlobalNormalizeStatsEnabled(bool enabled) {
+  global_stats_enabled = enabled;
+}
+
+bool GlobalNormalizeStatsEnabled() {
+  return global_stats_enabled;
+}
+
+void AddToGlobalNormalizeStats(const NormalizeStats &stats) {
+  std::lock_guard<std::mutex> lock(global_stats_mutex);
+  NormalizeStats *global_stats = GlobalStats();
+  global_stats->Add(stats);
+  // These would grow without bound.
+  global_stats->verbalizer_call_usec.clear();
+}
+
+NormalizeStats GetGlobalNormalizeStats() {
+  std::lock_guard<std::mutex> lock(global_stats_mutex);
+  return *GlobalStats();
+}
+
+void ResetGlobalNormalizeStats() {
+  std::lock_guard<std::mutex> lock(global_stats_mutex);
+  GlobalStats()->Clear();
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
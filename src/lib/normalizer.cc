@@ -13,27 +13,34 @@
 // Copyright 2015 and onwards Google, Inc.
 #include <sparrowhawk/normalizer.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 using std::string;
+#include <vector>
+using std::vector;
 
-#include <google/protobuf/text_format.h>
 #include <sparrowhawk/items.pb.h>
-#include <sparrowhawk/sentence_boundary.h>
-#include <sparrowhawk/serialization_spec.pb.h>
-#include <sparrowhawk/sparrowhawk_configuration.pb.h>
-#include <sparrowhawk/io_utils.h>
-#include <sparrowhawk/logger.h>
-#include <sparrowhawk/protobuf_parser.h>
-#include <sparrowhawk/protobuf_serializer.h>
-#include <sparrowhawk/spec_serializer.h>
-#include <sparrowhawk/string_utils.h>
+#include <sparrowhawk/normalizer_model.h>
+#include <sparrowhawk/normalizer_session.h>
+#include <sparrowhawk/thread_pool.h>
 
 namespace speech {
 namespace sparrowhawk {
 
-// TODO(rws): We actually need to do something with this.
-const char kDefaultSentenceBoundaryRegexp[] = "[\\.:!\\?] ";
+namespace {
+
+// Sentences normalized by Warmup(). They are mostly digits and symbols so that
+// they exercise the semiotic classes of most languages' grammars.
+const char *kWarmupSentences[] = {
+  "1 22 333 4444 55555 666666 7777777.",
+  "3.14 1/2 50% $5.50 10:30 2015-01-01 5 kg.",
+};
+
+}  // namespace
 
 Normalizer::Normalizer() { }
 
@@ -41,183 +48,103 @@ Normalizer::~Normalizer() { }
 
 bool Normalizer::Setup(const string &configuration_proto,
                        const string &pathname_prefix) {
-  SparrowhawkConfiguration configuration;
-  string proto_string = IOStream::LoadFileToString(pathname_prefix +
-                                                   "/" + configuration_proto);
-  if (!google::protobuf::TextFormat::ParseFromString(proto_string, &configuration))
-    return false;
-  if (!(configuration.has_tokenizer_grammar()))
-    LoggerError("Configuration does not define a tokenizer-classifier grammar");
-  if (!(configuration.has_verbalizer_grammar()))
-    LoggerError("Configuration does not define a verbalizer grammar");
-  tokenizer_classifier_rules_.reset(new RuleSystem);
-  if (!tokenizer_classifier_rules_->LoadGrammar(
-          configuration.tokenizer_grammar(),
-          pathname_prefix))
-    return false;
-  verbalizer_rules_.reset(new RuleSystem);
-  if (!verbalizer_rules_->LoadGrammar(configuration.verbalizer_grammar(),
-                                      pathname_prefix))
-    return false;
-  string sentence_boundary_regexp;
-  if (configuration.has_sentence_boundary_regexp()) {
-    sentence_boundary_regexp = configuration.sentence_boundary_regexp();
-  } else {
-    sentence_boundary_regexp = kDefaultSentenceBoundaryRegexp;
-  }
-  sentence_boundary_.reset(new SentenceBoundary(sentence_boundary_regexp));
-  if (configuration.has_sentence_boundary_exceptions_file()) {
-    if (!sentence_boundary_->LoadSentenceBoundaryExceptions(
-            configuration.sentence_boundary_exceptions_file())) {
-      LoggerError("Cannot load sentence boundary exceptions file: %s",
-                  configuration.sentence_boundary_exceptions_file().c_str());
-    }
-  }
-  if (configuration.has_serialization_spec()) {
-    string spec_string = IOStream::LoadFileToString(
-        pathname_prefix + "/" + configuration.serialization_spec());
-    SerializeSpec spec;
-    if (spec_string.empty() ||
-        !google::protobuf::TextFormat::ParseFromString(spec_string, &spec) ||
-        (spec_serializer_ = Serializer::Create(spec)) == nullptr) {
-      LoggerError("Failed to load a valid serialization spec from file: %s",
-                  configuration.serialization_spec().c_str());
-      return false;
-    }
+  session_.reset();
+  model_ = NormalizerModel::Create(configuration_proto, pathname_prefix);
+  if (model_ == nullptr) return false;
+  session_.reset(new NormalizerSession(model_));
+  return true;
+}
+
+bool Normalizer::Warmup() const {
+  if (model_ == nullptr) return false;
+  model_->Warmup();
+  string output;
+  for (const char *sentence : kWarmupSentences) {
+    // It does not matter whether the grammars can handle the samples, only
+    // that they have been run.
+    Normalize(sentence, &output);
   }
   return true;
 }
 
+bool Normalizer::SaveGrammarCaches() const {
+  if (model_ == nullptr) return false;
+  return model_->SaveGrammarCaches();
+}
+
+void Normalizer::ClearCaches() const {
+  if (model_ != nullptr) model_->ClearCaches();
+}
+
+bool Normalizer::RunSession(
+    const std::function<bool(NormalizerSession *)> &fn) const {
+  std::unique_lock<std::mutex> lock(session_mutex_, std::try_to_lock);
+  if (lock.owns_lock() && session_ != nullptr) return fn(session_.get());
+  NormalizerSession session(model_);
+  return fn(&session);
+}
+
 bool Normalizer::Normalize(const string &input, string *output) const {
-  std::unique_ptr<Utterance> utt;
-  utt.reset(new Utterance);
-  if (!Normalize(utt.get(), input)) return false;
-  *output = LinearizeWords(utt.get());
-  return true;
+  return RunSession([&](NormalizerSession *session) {
+    return session->Normalize(input, output);
+  });
 }
 
-bool Normalizer::Normalize(Utterance *utt, const string &input) const {
-  return TokenizeAndClassifyUtt(utt, input) && VerbalizeUtt(utt);
+bool Normalizer::Normalize(const string &input,
+                           string *output,
+                           NormalizeStats *stats) const {
+  return RunSession([&](NormalizerSession *session) {
+    return session->Normalize(input, output, stats);
+  });
 }
 
 bool Normalizer::NormalizeAndShowLinks(
     const string &input, string *output) const {
-  std::unique_ptr<Utterance> utt;
-  utt.reset(new Utterance);
-  if (!Normalize(utt.get(), input)) return false;
-  *output = ShowLinks(utt.get());
-  return true;
+  return RunSession([&](NormalizerSession *session) {
+    return session->NormalizeAndShowLinks(input, output);
+  });
 }
 
-bool Normalizer::TokenizeAndClassifyUtt(Utterance *utt,
-                                        const string &input) const {
-  typedef fst::StringCompiler<fst::StdArc> Compiler;
-  Compiler compiler(fst::StringTokenType::BYTE);
-  MutableTransducer input_fst, output;
-  if (!compiler(input, &input_fst)) {
-    LoggerError("Failed to compile input string \"%s\"", input.c_str());
-    return false;
-  }
-  if (!tokenizer_classifier_rules_->ApplyRules(input_fst,
-                                               &output,
-                                               true /*  use_lookahead */)) {
-    LoggerError("Failed to tokenize \"%s\"", input.c_str());
-    return false;
-  }
-  MutableTransducer shortest_path;
-  fst::ShortestPath(output, &shortest_path);
-  ProtobufParser parser(&shortest_path);
-  if (!parser.ParseTokensFromFST(utt, true /* set SEMIOTIC_CLASS */)) {
-    LoggerError("Failed to parse tokens from FST for \"%s\"", input.c_str());
-    return false;
-  }
-  return true;
+bool Normalizer::NormalizeBatch(const std::vector<string> &inputs,
+                                std::vector<string> *outputs,
+                                int num_threads) const {
+  outputs->clear();
+  outputs->resize(inputs.size());
+  const int num_inputs = inputs.size();
+  const int num_workers = std::max(1, std::min(num_threads, num_inputs));
+  std::atomic<int> next_input(0);
+  std::atomic<bool> success(true);
+  // Each worker keeps one session for its whole share of the batch, and takes
+  // the next unclaimed input whenever it finishes one. The calling thread is
+  // one of the workers.
+  const std::shared_ptr<ThreadPool> pool = GetBatchPool(num_workers - 1);
+  pool->ParallelFor(num_workers, [&](int worker) {
+    NormalizerSession session(model_);
+    for (int i = next_input++; i < num_inputs; i = next_input++) {
+      if (!session.Normalize(inputs[i], &(*outputs)[i])) success = false;
+    }
+  });
+  return success;
 }
 
-// As in Kestrel's Run(), this processes each token in turn and creates the Word
-// stream, adding words each with a unique wordid.  Takes a different action on
-// the type:
-//
-// PUNCT: do nothing
-// SEMIOTIC_CLASS: call verbalizer FSTs
-// WORD: add to word stream
-bool Normalizer::VerbalizeUtt(Utterance *utt) const {
-  for (int i = 0; i < utt->linguistic().tokens_size(); ++i) {
-    Token *token = utt->mutable_linguistic()->mutable_tokens(i);
-    string token_form = ToString(*token);
-    token->set_first_daughter(-1);  // Sets to default unset.
-    token->set_last_daughter(-1);   // Sets to default unset.
-    // Add a single silence for punctuation that forms phrase breaks. This is
-    // set via the grammar, though ultimately we'd like a proper phrasing
-    // module.
-    if (token->type() == Token::PUNCT) {
-      if (token->phrase_break() &&
-          (utt->linguistic().words_size() == 0 ||
-           utt->linguistic().words(
-               utt->linguistic().words_size() - 1).id() != "sil")) {
-        AddWord(utt, token, "sil");
-      }
-    } else if (token->type() == Token::SEMIOTIC_CLASS) {
-      if (!token->skip()) {
-        LoggerDebug("Verbalizing: [%s]\n", token_form.c_str());
-        string words;
-        if (VerbalizeSemioticClass(*token, &words)) {
-          AddWords(utt, token, words);
-        } else {
-          LoggerWarn("First-pass verbalization FAILED for [%s]",
-                     token_form.c_str());
-          // Back off to verbatim reading
-          string original_token = token->name();
-          token->Clear();
-          token->set_name(original_token);
-          token->set_verbatim(original_token);
-          if (VerbalizeSemioticClass(*token, &words)) {
-            LoggerWarn("Reversion to verbatim succeeded for [%s]",
-                       original_token.c_str());
-            AddWords(utt, token, words);
-          } else {
-            // If we've done our checks right, we should never get here
-            LoggerError("Verbalization FAILED for [%s]", token_form.c_str());
-          }
-        }
-      }
-    } else if (token->type() == Token::WORD) {
-      if (token->has_wordid()) {
-        AddWord(utt, token, token->wordid());
-      } else {
-        LoggerError("Token [%s] has type WORD but there is no word id",
-                    token_form.c_str());
-      }
-    } else {
-      LoggerError("No type found for [%s]", token_form.c_str());
-    }
+std::shared_ptr<ThreadPool> Normalizer::GetBatchPool(int num_threads) const {
+  std::lock_guard<std::mutex> lock(batch_pool_mutex_);
+  if (batch_pool_ == nullptr || batch_pool_->num_threads() < num_threads) {
+    batch_pool_ = std::make_shared<ThreadPool>(num_threads);
   }
-  LoggerDebug("Verbalize output: Words\n%s\n\n", LinearizeWords(utt).c_str());
-  return true;
+  return batch_pool_;
 }
 
-bool Normalizer::VerbalizeSemioticClass(const Token &markup,
-                                        string *words) const {
-  Token local(markup);
-  CleanFields(&local);
-  MutableTransducer input_fst;
-  if (spec_serializer_ == nullptr) {
-    ProtobufSerializer serializer(&local, &input_fst);
-    serializer.SerializeToFst();
-  } else {
-    input_fst = spec_serializer_->Serialize(local);
-  }
-  if (!verbalizer_rules_->ApplyRules(input_fst,
-                                     words,
-                                     false /* use_lookahead */)) {
-    LoggerError("Failed to verbalize \"%s\"", ToString(local).c_str());
-    return false;
-  }
-  return true;
+string Normalizer::LinearizeWords(Utterance *utt) const {
+  return NormalizerSession::LinearizeWords(*utt);
+}
+
+string Normalizer::ShowLinks(Utterance *utt) const {
+  return NormalizerSession::ShowLinks(*utt);
 }
 
 std::vector<string> Normalizer::SentenceSplitter(const string &input) const {
-  return sentence_boundary_->ExtractSentences(input);
+  return model_->SentenceSplitter(input);
 }
 
 }  // namespace sparrowhawk
@@ -0,0 +1,137 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/normalizer_model.h>
+
+#include <memory>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <google/protobuf/text_format.h>
+#include <sparrowhawk/serialization_spec.pb.h>
+#include <sparrowhawk/sparrowhawk_configuration.pb.h>
+#include <sparrowhawk/io_utils.h>
+#include <sparrowhawk/logger.h>
+#include <sparrowhawk/sentence_boundary.h>
+#include <sparrowhawk/spec_serializer.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+// TODO(rws): We actually need to do something with this.
+const char kDefaultSentenceBoundaryRegexp[] = "[\\.:!\\?] ";
+
+NormalizerModel::NormalizerModel() { }
+
+NormalizerModel::~NormalizerModel() { }
+
+std::shared_ptr<const NormalizerModel> NormalizerModel::Create(
+    const string &configuration_proto, const string &pathname_prefix) {
+  std::shared_ptr<NormalizerModel> model(new NormalizerModel());
+  if (!model->Setup(configuration_proto, pathname_prefix)) return nullptr;
+  return model;
+}
+
+bool NormalizerModel::Setup(const string &configuration_proto,
+                            const string &pathname_prefix) {
+  string proto_string = IOStream::LoadFileToString(pathname_prefix +
+                                                   "/" + configuration_proto);
+  if (!google::protobuf::TextFormat::ParseFromString(proto_string,
+                                                     &configuration_))
+    return false;
+  if (!(configuration_.has_tokenizer_grammar()))
+    LoggerError("Configuration does not define a tokenizer-classifier grammar");
+  if (!(configuration_.has_verbalizer_grammar()))
+    LoggerError("Configuration does not define a verbalizer grammar");
+  tokenizer_classifier_rules_.reset(new RuleSystem);
+  tokenizer_classifier_rules_->set_num_load_threads(
+      configuration_.grammar_load_threads());
+  tokenizer_classifier_rules_->set_memory_map(
+      configuration_.memory_map_grammars());
+  if (!tokenizer_classifier_rules_->LoadGrammar(
+          configuration_.tokenizer_grammar(),
+          pathname_prefix))
+    return false;
+  verbalizer_rules_.reset(new RuleSystem);
+  // The verbalizer is never applied with lookahead.
+  verbalizer_rules_->set_prepare_lookaheads(false);
+  verbalizer_rules_->set_memory_map(configuration_.memory_map_grammars());
+  if (!verbalizer_rules_->LoadGrammar(configuration_.verbalizer_grammar(),
+                                      pathname_prefix))
+    return false;
+  string sentence_boundary_regexp;
+  if (configuration_.has_sentence_boundary_regexp()) {
+    sentence_boundary_regexp = configuration_.sentence_boundary_regexp();
+  } else {
+    sentence_boundary_regexp = kDefaultSentenceBoundaryRegexp;
+  }
+  sentence_boundary_.reset(new SentenceBoundary(sentence_boundary_regexp));
+  if (configuration_.has_sentence_boundary_exceptions_file()) {
+    if (!sentence_boundary_->LoadSentenceBoundaryExceptions(
+            configuration_.sentence_boundary_exceptions_file())) {
+      LoggerError("Cannot load sentence boundary exceptions file: %s",
+                  configuration_.sentence_boundary_exceptions_file().c_str());
+    }
+  }
+  if (configuration_.has_serialization_spec()) {
+    string spec_string = IOStream::LoadFileToString(
+        pathname_prefix + "/" + configuration_.serialization_spec());
+    SerializeSpec spec;
+    if (spec_string.empty() ||
+        !google::protobuf::TextFormat::ParseFromString(spec_string, &spec) ||
+        (spec_serializer_ = Serializer::Create(spec)) == nullptr) {
+      LoggerError("Failed to load a valid serialization spec from file: %s",
+                  configuration_.serialization_spec().c_str());
+      return false;
+    }
+  }
+  if (configuration_.verbalization_cache_size() > 0) {
+    verbalization_cache_.reset(
+        new LruCache<string>(configuration_.verbalization_cache_size()));
+  }
+  if (configuration_.sentence_cache_bytes() > 0) {
+    sentence_cache_.reset(new LruCache<NormalizedSentence>(
+        configuration_.sentence_cache_bytes()));
+  }
+  if (configuration_.verbalizer_threads() > 1) {
+    // The calling thread does its share of the work.
+    verbalizer_pool_.reset(
+        new ThreadPool(configuration_.verbalizer_threads() - 1));
+  }
+  return true;
+}
+
+void NormalizerModel::Warmup() const {
+  tokenizer_classifier_rules_->Warmup();
+  verbalizer_rules_->Warmup();
+}
+
+void NormalizerModel::ClearCaches() const {
+  if (verbalization_cache_ != nullptr) verbalization_cache_->Clear();
+  if (sentence_cache_ != nullptr) sentence_cache_->Clear();
+}
+
+bool NormalizerModel::SaveGrammarCaches() const {
+  return tokenizer_classifier_rules_->SaveCache() &&
+      verbalizer_rules_->SaveCache();
+}
+
+std::vector<string> NormalizerModel::SentenceSplitter(
+    const string &input) const {
+  return sentence_boundary_->ExtractSentences(input);
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
@@ -0,0 +1,323 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/normalizer_session.h>
+
+#include <memory>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <google/protobuf/descriptor.h>
+#include <sparrowhawk/items.pb.h>
+#include <sparrowhawk/logger.h>
+#include <sparrowhawk/lru_cache.h>
+#include <sparrowhawk/normalizer_model.h>
+#include <sparrowhawk/protobuf_parser.h>
+#include <sparrowhawk/protobuf_serializer.h>
+#include <sparrowhawk/spec_serializer.h>
+#include <sparrowhawk/thread_pool.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+namespace {
+
+// The name under which stats count the token: its type, or the name of its
+// class for a semiotic class.
+string TokenClass(const Token &token) {
+  if (token.type() == Token::SEMIOTIC_CLASS) {
+    std::vector<const google::protobuf::FieldDescriptor *> fields;
+    token.GetReflection()->ListFields(token, &fields);
+    for (const auto *field : fields) {
+      if (field->number() >= Token::kCardinalFieldNumber &&
+          field->number() <= Token::kAbbreviationFieldNumber) {
+        return field->name();
+      }
+    }
+  }
+  return Token::Type_Name(token.type());
+}
+
+}  // namespace
+
+NormalizerSession::NormalizerSession(
+    std::shared_ptr<const NormalizerModel> model)
+    : model_(model),
+      stats_(nullptr) { }
+
+NormalizerSession::~NormalizerSession() { }
+
+bool NormalizerSession::Normalize(const string &input, string *output) {
+  return Normalize(input, output, nullptr);
+}
+
+bool NormalizerSession::NormalizeAndShowLinks(const string &input,
+                                              string *output) {
+  return NormalizeAndShowLinks(input, output, nullptr);
+}
+
+bool NormalizerSession::Normalize(const string &input,
+                                  string *output,
+                                  NormalizeStats *stats) {
+  StartStats(stats);
+  bool success;
+  LruCache<NormalizedSentence> *cache = model_->sentence_cache();
+  if (cache != nullptr) {
+    success = NormalizeCached(input, cache);
+    if (success) *output = sentence_.words;
+  } else {
+    success = Normalize(input);
+    if (success) *output = LinearizeWords(utt_);
+  }
+  FinishStats();
+  return success;
+}
+
+bool NormalizerSession::NormalizeAndShowLinks(const string &input,
+                                              string *output,
+                                              NormalizeStats *stats) {
+  StartStats(stats);
+  bool success;
+  LruCache<NormalizedSentence> *cache = model_->sentence_cache();
+  if (cache != nullptr) {
+    success = NormalizeCached(input, cache);
+    if (success) *output = sentence_.links;
+  } else {
+    success = Normalize(input);
+    if (success) *output = ShowLinks(utt_);
+  }
+  FinishStats();
+  return success;
+}
+
+void NormalizerSession::StartStats(NormalizeStats *stats) {
+  if (stats == nullptr && GlobalNormalizeStatsEnabled()) stats = &call_stats_;
+  stats_ = stats;
+  if (stats_ == nullptr) return;
+  stats_->Clear();
+  stats_->num_sentences = 1;
+}
+
+void NormalizerSession::FinishStats() {
+  if (stats_ != nullptr && GlobalNormalizeStatsEnabled()) {
+    AddToGlobalNormalizeStats(*stats_);
+  }
+  stats_ = nullptr;
+}
+
+bool NormalizerSession::NormalizeCached(const string &input,
+                                        LruCache<NormalizedSentence> *cache) {
+  if (cache->Lookup(input, &sentence_)) {
+    if (stats_ != nullptr) ++stats_->num_sentence_cache_hits;
+    return true;
+  }
+  if (!Normalize(input)) return false;
+  // Both forms are cached, whichever was asked for, so that either kind of
+  // request for the sentence can be answered next time.
+  sentence_.words = LinearizeWords(utt_);
+  sentence_.links = ShowLinks(utt_);
+  cache->Insert(input, sentence_,
+                input.size() + sentence_.words.size() +
+                sentence_.links.size() + sizeof(NormalizedSentence));
+  return true;
+}
+
+bool NormalizerSession::Normalize(const string &input) {
+  // Clear() keeps the allocated tokens and words around for reuse.
+  utt_.Clear();
+  return TokenizeAndClassifyUtt(&utt_, input) && VerbalizeUtt(&utt_);
+}
+
+bool NormalizerSession::TokenizeAndClassifyUtt(Utterance *utt,
+                                               const string &input) {
+  {
+    ScopedStageTimer timer(stats_ ? &stats_->tokenizer_usec : nullptr);
+    if (!model_->tokenizer_classifier_rules().ApplyRulesToBestPath(
+            input,
+            true /*  use_lookahead */,
+            &best_path_,
+            stats_ ? &stats_->tokenizer_output_states : nullptr,
+            stats_ ? &stats_->tokenizer_output_arcs : nullptr)) {
+      LoggerError("Failed to tokenize \"%s\"", input.c_str());
+      return false;
+    }
+  }
+  if (stats_ != nullptr) stats_->best_path_length = best_path_.size();
+  ScopedStageTimer timer(stats_ ? &stats_->parse_usec : nullptr);
+  ProtobufParser parser(best_path_);
+  if (!parser.ParseTokensFromFST(utt, true /* set SEMIOTIC_CLASS */)) {
+    LoggerError("Failed to parse tokens from FST for \"%s\"", input.c_str());
+    return false;
+  }
+  return true;
+}
+
+// As in Kestrel's Run(), this processes each token in turn and creates the Word
+// stream, adding words each with a unique wordid.  Takes a different action on
+// the type:
+//
+// PUNCT: do nothing
+// SEMIOTIC_CLASS: call verbalizer FSTs
+// WORD: add to word stream
+//
+// With a verbalizer pool, the semiotic classes are all verbalized up front, and
+// this loop only links their words into the utterance in order.
+bool NormalizerSession::VerbalizeUtt(Utterance *utt) {
+  ThreadPool *pool = model_->verbalizer_pool();
+  if (pool != nullptr) VerbalizeSemioticClassesInParallel(*utt, pool);
+  for (int i = 0; i < utt->linguistic().tokens_size(); ++i) {
+    Token *token = utt->mutable_linguistic()->mutable_tokens(i);
+    string token_form = ToString(*token);
+    if (stats_ != nullptr) ++stats_->tokens_per_class[TokenClass(*token)];
+    token->set_first_daughter(-1);  // Sets to default unset.
+    token->set_last_daughter(-1);   // Sets to default unset.
+    // Add a single silence for punctuation that forms phrase breaks. This is
+    // set via the grammar, though ultimately we'd like a proper phrasing
+    // module.
+    if (token->type() == Token::PUNCT) {
+      if (token->phrase_break() &&
+          (utt->linguistic().words_size() == 0 ||
+           utt->linguistic().words(
+               utt->linguistic().words_size() - 1).id() != "sil")) {
+        AddWord(utt, token, "sil");
+      }
+    } else if (token->type() == Token::SEMIOTIC_CLASS) {
+      if (!token->skip()) {
+        LoggerDebug("Verbalizing: [%s]\n", token_form.c_str());
+        Verbalization *verbalization = &verbalization_;
+        if (pool != nullptr) {
+          verbalization = &verbalizations_[i];
+        } else {
+          VerbalizeSemioticClass(*token, verbalization);
+        }
+        AddVerbalizationStats(*verbalization);
+        if (verbalization->success) {
+          AddWords(utt, token, verbalization->words);
+        } else {
+          LoggerWarn("First-pass verbalization FAILED for [%s]",
+                     token_form.c_str());
+          // Back off to verbatim reading
+          string original_token = token->name();
+          token->Clear();
+          token->set_name(original_token);
+          token->set_verbatim(original_token);
+          if (stats_ != nullptr) ++stats_->num_verbatim_fallbacks;
+          const bool reverted = VerbalizeSemioticClass(*token, verbalization);
+          AddVerbalizationStats(*verbalization);
+          if (reverted) {
+            LoggerWarn("Reversion to verbatim succeeded for [%s]",
+                       original_token.c_str());
+            AddWords(utt, token, verbalization->words);
+          } else {
+            // If we've done our checks right, we should never get here
+            LoggerError("Verbalization FAILED for [%s]", token_form.c_str());
+          }
+        }
+      }
+    } else if (token->type() == Token::WORD) {
+      if (token->has_wordid()) {
+        AddWord(utt, token, token->wordid());
+      } else {
+        LoggerError("Token [%s] has type WORD but there is no word id",
+                    token_form.c_str());
+      }
+    } else {
+      LoggerError("No type found for [%s]", token_form.c_str());
+    }
+  }
+  LoggerDebug("Verbalize output: Words\n%s\n\n", LinearizeWords(*utt).c_str());
+  return true;
+}
+
+void NormalizerSession::VerbalizeSemioticClassesInParallel(
+    const Utterance &utt, ThreadPool *pool) {
+  const int num_tokens = utt.linguistic().tokens_size();
+  // Only ever grows, so that the verbalizations' buffers are reused.
+  if (verbalizations_.size() < num_tokens) verbalizations_.resize(num_tokens);
+  semiotic_class_tokens_.clear();
+  for (int i = 0; i < num_tokens; ++i) {
+    const Token &token = utt.linguistic().tokens(i);
+    if (token.type() == Token::SEMIOTIC_CLASS && !token.skip()) {
+      semiotic_class_tokens_.push_back(i);
+    }
+  }
+  pool->ParallelFor(semiotic_class_tokens_.size(), [this, &utt](int i) {
+    const int token_index = semiotic_class_tokens_[i];
+    VerbalizeSemioticClass(utt.linguistic().tokens(token_index),
+                           &verbalizations_[token_index]);
+  });
+}
+
+void NormalizerSession::AddVerbalizationStats(
+    const Verbalization &verbalization) {
+  if (stats_ == nullptr) return;
+  if (verbalization.cache_hit) {
+    ++stats_->num_verbalization_cache_hits;
+    return;
+  }
+  stats_->serialization_usec += verbalization.serialization_usec;
+  stats_->verbalizer_usec += verbalization.verbalizer_usec;
+  ++stats_->num_verbalizer_calls;
+  stats_->verbalizer_call_usec.push_back(verbalization.verbalizer_usec);
+}
+
+bool NormalizerSession::VerbalizeSemioticClass(
+    const Token &markup, Verbalization *verbalization) const {
+  Token *token = &verbalization->token;
+  string *words = &verbalization->words;
+  verbalization->success = false;
+  verbalization->cache_hit = false;
+  verbalization->serialization_usec = 0;
+  verbalization->verbalizer_usec = 0;
+  token->CopyFrom(markup);
+  CleanFields(token);
+  LruCache<string> *cache = model_->verbalization_cache();
+  if (cache != nullptr) {
+    token->SerializeToString(&verbalization->cache_key);
+    if (cache->Lookup(verbalization->cache_key, words)) {
+      verbalization->success = true;
+      verbalization->cache_hit = true;
+      return true;
+    }
+  }
+  {
+    ScopedStageTimer timer(stats_ ? &verbalization->serialization_usec
+                                  : nullptr);
+    const Serializer *spec_serializer = model_->spec_serializer();
+    if (spec_serializer == nullptr) {
+      ProtobufSerializer serializer(token, &verbalization->input);
+      serializer.set_max_any_order_fields(
+          model_->configuration().max_any_order_fields());
+      serializer.SerializeToFst();
+    } else {
+      spec_serializer->Serialize(*token, &verbalization->input);
+    }
+  }
+  {
+    ScopedStageTimer timer(stats_ ? &verbalization->verbalizer_usec : nullptr);
+    if (!model_->verbalizer_rules().ApplyRules(verbalization->input,
+                                               words,
+                                               false /* use_lookahead */)) {
+      LoggerError("Failed to verbalize \"%s\"", ToString(*token).c_str());
+      return false;
+    }
+  }
+  if (cache != nullptr) cache->Insert(verbalization->cache_key, *words, 1);
+  verbalization->success = true;
+  return true;
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
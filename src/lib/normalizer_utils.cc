@@ -14,8 +14,8 @@
 // TODO(rws): This is small enough now that maybe we don't really need this
 // separate file.
 //
-// More definitions for the Normalizer class, put here because they are icky
-// low-level hanky panky.
+// More definitions for the NormalizerSession class, put here because they are
+// icky low-level hanky panky.
 
 // utt->AppendToken()
 // utt->AppendWord()
@@ -25,7 +25,7 @@
 using std::string;
 
 #include <sparrowhawk/items.pb.h>
-#include <sparrowhawk/normalizer.h>
+#include <sparrowhawk/normalizer_session.h>
 #include <sparrowhawk/protobuf_serializer.h>
 #include <sparrowhawk/string_utils.h>
 
@@ -35,7 +35,7 @@ namespace sparrowhawk {
 // Same as in Kestrel: add a phrase boundary at the beginning and ending of the
 // utterance.
 
-void Normalizer::AddPhraseToUtt(Utterance* utt, bool addword) const {
+void NormalizerSession::AddPhraseToUtt(Utterance* utt, bool addword) const {
   Token* token = utt->mutable_linguistic()->add_tokens();
   token->set_type(Token::PUNCT);
   token->set_name("");
@@ -43,7 +43,7 @@ void Normalizer::AddPhraseToUtt(Utterance* utt, bool addword) const {
   if (addword) AddWord(utt, token, "sil");
 }
 
-int Normalizer::TokenIndex(Utterance* utt, Token *token) const {
+int NormalizerSession::TokenIndex(Utterance* utt, Token *token) const {
   for (int i = 0; i < utt->linguistic().tokens_size(); ++i) {
     const class Token *t = &(utt->linguistic().tokens(i));
     if (t == token) {
@@ -53,9 +53,9 @@ int Normalizer::TokenIndex(Utterance* utt, Token *token) const {
   return -1;
 }
 
-Word* Normalizer::AddWord(Utterance* utt,
-                          Token* token,
-                          const string& spelling) const {
+Word* NormalizerSession::AddWord(Utterance* utt,
+                                 Token* token,
+                                 const string& spelling) const {
   Word* word = utt->mutable_linguistic()->add_words();
   int word_index = utt->linguistic().words_size() - 1;
   if (!token->has_first_daughter() || token->first_daughter() == -1) {
@@ -73,8 +73,8 @@ Word* Normalizer::AddWord(Utterance* utt,
 // We assume that if someone puts a "," in the verbalization grammar, they mean
 // for this to represent a phrase boundary, so we add in logic here fore that.
 
-Word* Normalizer::AddWords(Utterance* utt, Token* token,
-                           const string& words) const {
+Word* NormalizerSession::AddWords(Utterance* utt, Token* token,
+                                  const string& words) const {
   std::vector<string> word_names = SplitString(words, " \t\n");
   Word* word = NULL;
 
@@ -87,7 +87,7 @@ Word* Normalizer::AddWords(Utterance* utt, Token* token,
   return word;  // return last word added.
 }
 
-void Normalizer::CleanFields(Token* markup) const {
+void NormalizerSession::CleanFields(Token* markup) const {
   markup->clear_first_daughter();
   markup->clear_last_daughter();
   markup->clear_type();
@@ -99,46 +99,41 @@ void Normalizer::CleanFields(Token* markup) const {
   markup->clear_name();
 }
 
-string Normalizer::InputSubstring(int left, int right) const {
-  if (left < 0 || right >= input_.size() || left > right) return "";
-  return input_.substr(left, right - left + 1);
-}
-
-string Normalizer::LinearizeWords(Utterance* utt) const {
+string NormalizerSession::LinearizeWords(const Utterance& utt) {
   string output;
-  for (int i = 0; i < utt->linguistic().words_size(); ++i) {
+  for (int i = 0; i < utt.linguistic().words_size(); ++i) {
     if (i) output.append(" ");
-    output.append(utt->linguistic().words(i).spelling());
+    output.append(utt.linguistic().words(i).spelling());
   }
   return output;
 }
 
-string Normalizer::ShowLinks(Utterance *utt) const {
+string NormalizerSession::ShowLinks(const Utterance &utt) {
   string output;
-  for (int i = 0; i < utt->linguistic().tokens_size(); ++i) {
+  for (int i = 0; i < utt.linguistic().tokens_size(); ++i) {
     output.append("Token:\t" + std::to_string(i) + "\t");
-    output.append(utt->linguistic().tokens(i).name() + "\t");
+    output.append(utt.linguistic().tokens(i).name() + "\t");
     // Start and end positions in the input string.
-    output.append(std::to_string(utt->linguistic().tokens(i).start_index()));
+    output.append(std::to_string(utt.linguistic().tokens(i).start_index()));
     output.append(",");
-    output.append(std::to_string(utt->linguistic().tokens(i).end_index()));
+    output.append(std::to_string(utt.linguistic().tokens(i).end_index()));
     output.append("\t");
     // First and last word daughters.
-    output.append(std::to_string(utt->linguistic().tokens(i).first_daughter()));
+    output.append(std::to_string(utt.linguistic().tokens(i).first_daughter()));
     output.append(",");
-    output.append(std::to_string(utt->linguistic().tokens(i).last_daughter()));
+    output.append(std::to_string(utt.linguistic().tokens(i).last_daughter()));
     output.append("\n");
   }
-  for (int i = 0; i < utt->linguistic().words_size(); ++i) {
+  for (int i = 0; i < utt.linguistic().words_size(); ++i) {
     output.append("Word:\t" + std::to_string(i) + "\t");
-    output.append(utt->linguistic().words(i).spelling());
-    output.append("\t" + std::to_string(utt->linguistic().words(i).parent()));
+    output.append(utt.linguistic().words(i).spelling());
+    output.append("\t" + std::to_string(utt.linguistic().words(i).parent()));
     output.append("\n");
   }
   return output;
 }
 
-string Normalizer::ToString(const Token& markup) const {
+string NormalizerSession::ToString(const Token& markup) const {
   ProtobufSerializer serializer(&markup, NULL);
   return serializer.SerializeToString();
 }
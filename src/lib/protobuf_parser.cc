@@ -19,6 +19,7 @@
 #include <google/protobuf/message.h>
 #include <sparrowhawk/items.pb.h>
 #include <sparrowhawk/logger.h>
+#include <sparrowhawk/message_fields.h>
 #include <sparrowhawk/numbers.h>
 
 namespace speech {
@@ -31,9 +32,19 @@ using google::protobuf::Message;
 using google::protobuf::Reflection;
 
 ProtobufParser::ProtobufParser(const Transducer *fst)
-    : fst_(fst),
-      state_(fst->Start()),
-      last_state_(fst->Start()),
+    : has_start_(fst->Start() != fst::kNoStateId),
+      position_(0),
+      ilabel_(0),
+      olabel_(0),
+      token_start_(0),
+      last_token_end_(0) {
+  GetPathLabels(*fst, &path_);
+}
+
+ProtobufParser::ProtobufParser(const LabelPath &path)
+    : has_start_(true),
+      path_(path),
+      position_(0),
       ilabel_(0),
       olabel_(0),
       token_start_(0),
@@ -44,7 +55,7 @@ ProtobufParser::~ProtobufParser() {}
 bool ProtobufParser::ParseTokensFromFST(Utterance *utt,
                                         bool set_semiotic_class,
                                         bool fix_lookahead) {
-  if (state_ == fst::kNoStateId) {
+  if (!has_start_) {
     LoggerError("Attempt to parse tokens from invalid state.");
     return false;
   }
@@ -103,12 +114,12 @@ void ProtobufParser::ConsumeWhitespace() {
 }
 
 bool ProtobufParser::NextState() {
-  ArcIterator arc(*fst_, state_);
-  if (arc.Done()) {
+  if (position_ == path_.size()) {
     return false;
   }
-  ilabel_ = arc.Value().ilabel;
-  olabel_ = arc.Value().olabel;
+  ilabel_ = path_[position_].first;
+  olabel_ = path_[position_].second;
+  ++position_;
   if (ilabel_) {
     // Don't aggregate leading whitespace against a token.
     if (ilabel_ == ' ' && token_name_.empty()) {
@@ -117,13 +128,11 @@ bool ProtobufParser::NextState() {
       token_name_.push_back(ilabel_);
     }
   }
-  last_state_ = state_;
-  state_ = arc.Value().nextstate;
   return true;
 }
 
 void ProtobufParser::PrevState() {
-  state_ = last_state_;
+  --position_;
   // Have to undo any input aggregation we might have done.
   if (ilabel_) {
     if (ilabel_ == ' ' && token_name_.empty()) {
@@ -137,6 +146,9 @@ void ProtobufParser::PrevState() {
 bool ProtobufParser::ParseMessage(bool eof_allowed, Message *message) {
   const Descriptor *descriptor = message->GetDescriptor();
   const Reflection *reflection = message->GetReflection();
+  // The generated accessors, if the message type has them; otherwise the
+  // fields are found and set through reflection.
+  const MessageFields *generated = FindMessageFields(descriptor);
   string label;
   // Record of the order in which the fields came in
   std::vector<string> field_order;
@@ -159,7 +171,8 @@ bool ProtobufParser::ParseMessage(bool eof_allowed, Message *message) {
       LoggerError("field_order should not be specified in the input");
       return false;
     }
-    const FieldDescriptor *field_descriptor =
+    const FieldDescriptor *field_descriptor = generated != NULL ?
+        generated->FindFieldByName(label) :
         descriptor->FindFieldByName(label);
     if (field_descriptor == NULL) {
       LoggerError("Unknown field: [%s]", label.c_str());
@@ -169,7 +182,9 @@ bool ProtobufParser::ParseMessage(bool eof_allowed, Message *message) {
     if (field_descriptor->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
       NextState();  // consume opening brace.
       Message *submessage;
-      if (field_descriptor->is_repeated()) {
+      if (generated != NULL) {
+        submessage = generated->MutableMessage(message, field_descriptor);
+      } else if (field_descriptor->is_repeated()) {
         submessage = reflection->AddMessage(message, field_descriptor);
       } else {
         submessage = reflection->MutableMessage(message, field_descriptor);
@@ -183,7 +198,10 @@ bool ProtobufParser::ParseMessage(bool eof_allowed, Message *message) {
       if (!ParseFieldValue(&value)) {
         return false;
       }
-      SetField(message, reflection, field_descriptor, value);
+      if (generated == NULL ||
+          !generated->SetFieldFromString(message, field_descriptor, value)) {
+        SetField(message, reflection, field_descriptor, value);
+      }
     }
     ConsumeWhitespace();
   }
@@ -210,7 +228,10 @@ bool ProtobufParser::ParseFieldValue(string *value) {
 
 bool ProtobufParser::ParseQuotedFieldValue(bool ignore_backslashes,
                                            string *value) {
-  const StateId initial_state = state_;
+  // Where to start again from when retrying.
+  const size_t initial_position = position_;
+  const int initial_token_start = token_start_;
+  const size_t initial_token_name_size = token_name_.size();
   bool last_backslash = false;
   while (NextState()) {
     if (olabel_ == '\\' && !last_backslash) {
@@ -225,7 +246,9 @@ bool ProtobufParser::ParseQuotedFieldValue(bool ignore_backslashes,
   if (!ignore_backslashes) {
     LoggerWarn("Failure reading field; will try ignoring backslashes.");
     value->clear();
-    state_ = initial_state;
+    position_ = initial_position;
+    token_start_ = initial_token_start;
+    token_name_.erase(initial_token_name_size);
     return ParseQuotedFieldValue(true, value);
   } else {
     LoggerError("Unexpected EOF while reading field");
@@ -315,12 +338,12 @@ void ProtobufParser::FixLookahead(Utterance *utt) {
 void ProtobufParser::LogError() {
   // Log the entire string that we've failed to parse.
   string message;
-  state_ = fst_->Start();
-  while (NextState()) {
-    if (olabel_) {
-      message.push_back(olabel_);
+  for (const auto &labels : path_) {
+    if (labels.second) {
+      message.push_back(labels.second);
     }
   }
+  position_ = path_.size();
   LoggerError("Full input: [%s]", message.c_str());
 }
 
@@ -11,15 +11,24 @@
 // limitations under the License.
 //
 // Copyright 2015 and onwards Google, Inc.
-#include <algorithm>
-#include <map>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+using std::vector;
 
 #include <google/protobuf/text_format.h>
+#include <sparrowhawk/items.pb.h>
+#include <sparrowhawk/message_fields.h>
 #include <sparrowhawk/protobuf_serializer.h>
 
 namespace speech {
 namespace sparrowhawk {
 
+const int ProtobufSerializer::kDefaultMaxAnyOrderFields;
+const int ProtobufSerializer::kMaxMaxAnyOrderFields;
+
 typedef ProtobufSerializer::MutableTransducer MutableTransducer;
 typedef MutableTransducer::Arc Arc;
 typedef Arc::Weight Weight;
@@ -31,6 +40,7 @@ using fst::kNoLabel;
 using google::protobuf::Descriptor;
 using google::protobuf::EnumValueDescriptor;
 using google::protobuf::FieldDescriptor;
+using google::protobuf::FileDescriptor;
 using google::protobuf::Message;
 using google::protobuf::Reflection;
 using google::protobuf::Message;
@@ -40,7 +50,9 @@ ProtobufSerializer::ProtobufSerializer(const Message *message,
     : message_(message),
       reflection_(message->GetReflection()),
       fst_(fst),
-      initial_state_(0) {
+      initial_state_(0),
+      plan_(GetMessagePlan(message->GetDescriptor())),
+      max_any_order_fields_(kDefaultMaxAnyOrderFields) {
 }
 
 ProtobufSerializer::ProtobufSerializer(const Message *message,
@@ -49,7 +61,9 @@ ProtobufSerializer::ProtobufSerializer(const Message *message,
     : message_(message),
       reflection_(message->GetReflection()),
       fst_(fst),
-      initial_state_(state) {
+      initial_state_(state),
+      plan_(GetMessagePlan(message->GetDescriptor())),
+      max_any_order_fields_(kDefaultMaxAnyOrderFields) {
 }
 
 ProtobufSerializer::~ProtobufSerializer() {
@@ -57,20 +71,8 @@ ProtobufSerializer::~ProtobufSerializer() {
 
 namespace {
 
-// Sort fields by their field number, which is a nice easy ordering on them.
-struct OrderByFieldNumber {
-  bool operator()(const FieldDescriptor *a, const FieldDescriptor *b) const {
-    return a->number() < b->number();
-  }
-};
-
-struct FindFieldByName {
-  explicit FindFieldByName(const char *name) : name_(name) {}
-  bool operator()(const FieldDescriptor *descriptor) const {
-    return name_ == descriptor->name();
-  }
-  const string name_;
-};
+// Cost of leaving out an optional field.
+const float kSkipOptionalFieldCost = 1.0;
 
 inline string PrintToString(const google::protobuf::MessageLite &message) {
   string output;
@@ -79,6 +81,154 @@ inline string PrintToString(const google::protobuf::MessageLite &message) {
 }
 }  // anonymous namespace
 
+// What SerializeField() needs to know about a field, worked out once per field.
+struct ProtobufSerializer::FieldPlan {
+  enum Kind {
+    MESSAGE, STRING, ENUM, BOOL, INT32, INT64, UINT32, UINT64, OTHER
+  };
+
+  const FieldDescriptor *field;
+  Kind kind;
+  // "name { " for messages, and "name: " otherwise.
+  string prefix;
+  // Fields that may be left out, so that languages which don't use them can
+  // still consume inputs with them.
+  bool optional;
+};
+
+// The FieldPlans of all the fields of a message type, indexed by
+// FieldDescriptor::index(), and the fields that control the ordering.
+struct ProtobufSerializer::MessagePlan {
+  std::vector<FieldPlan> fields;
+  const FieldDescriptor *preserve_order_field;
+  const FieldDescriptor *field_order_field;
+  // The generated accessors of the message type, if it has them.
+  const MessageFields *generated;
+  // Set once a message of the type has had too many fields to serialize in
+  // any order, so that this is only logged once.
+  mutable std::atomic<bool> warned_too_many_fields;
+};
+
+namespace {
+
+const char kMessageSuffix[] = " }";
+
+// Prints the values of the fields that are not serialized directly. Printing
+// does not change the printer, so all threads can share one.
+const google::protobuf::TextFormat::Printer &ValuePrinter() {
+  static const google::protobuf::TextFormat::Printer *printer = [] {
+    google::protobuf::TextFormat::Printer *printer =
+        new google::protobuf::TextFormat::Printer;
+    printer->SetUseUtf8StringEscaping(true);
+    return printer;
+  }();
+  return *printer;
+}
+
+}  // namespace
+
+void ProtobufSerializer::MakeFieldPlan(const FieldDescriptor *field,
+                                       FieldPlan *plan) {
+  plan->field = field;
+  plan->optional = field->name() == "morphosyntactic_features";
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      plan->kind = FieldPlan::MESSAGE;
+      break;
+    case FieldDescriptor::CPPTYPE_STRING:
+      // Bytes are escaped by TextFormat.
+      plan->kind = field->type() == FieldDescriptor::TYPE_STRING ?
+          FieldPlan::STRING : FieldPlan::OTHER;
+      break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+      plan->kind = FieldPlan::ENUM;
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      plan->kind = FieldPlan::BOOL;
+      break;
+    case FieldDescriptor::CPPTYPE_INT32:
+      plan->kind = FieldPlan::INT32;
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      plan->kind = FieldPlan::INT64;
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      plan->kind = FieldPlan::UINT32;
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      plan->kind = FieldPlan::UINT64;
+      break;
+    default:
+      plan->kind = FieldPlan::OTHER;
+      break;
+  }
+  plan->prefix = field->name() +
+      (plan->kind == FieldPlan::MESSAGE ? " { " : ": ");
+}
+
+const ProtobufSerializer::MessagePlan *ProtobufSerializer::MakeMessagePlan(
+    const Descriptor *descriptor) {
+  MessagePlan *plan = new MessagePlan;
+  plan->fields.resize(descriptor->field_count());
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    MakeFieldPlan(descriptor->field(i), &plan->fields[i]);
+  }
+  plan->preserve_order_field = descriptor->FindFieldByName("preserve_order");
+  plan->field_order_field = descriptor->FindFieldByName("field_order");
+  plan->generated = FindMessageFields(descriptor);
+  plan->warned_too_many_fields = false;
+  return plan;
+}
+
+const ProtobufSerializer::MessagePlan *ProtobufSerializer::GetMessagePlan(
+    const Descriptor *descriptor) {
+  typedef std::unordered_map<const Descriptor *, const MessagePlan *> PlanMap;
+  // None of the plans are deleted, as they point into descriptors that live as
+  // long as the program.
+  // The plans of the message types of items.proto and of every message type
+  // their fields can hold, which are only read once built.
+  static PlanMap *plans = new PlanMap;
+  static std::once_flag plans_built;
+  std::call_once(plans_built, [] {
+    std::vector<const Descriptor *> pending;
+    const FileDescriptor *file = Token::descriptor()->file();
+    for (int i = 0; i < file->message_type_count(); ++i) {
+      pending.push_back(file->message_type(i));
+    }
+    while (!pending.empty()) {
+      const Descriptor *type = pending.back();
+      pending.pop_back();
+      if (plans->count(type) > 0) continue;
+      (*plans)[type] = MakeMessagePlan(type);
+      for (int i = 0; i < type->nested_type_count(); ++i) {
+        pending.push_back(type->nested_type(i));
+      }
+      for (int i = 0; i < type->field_count(); ++i) {
+        const Descriptor *field_type = type->field(i)->message_type();
+        if (field_type != NULL) pending.push_back(field_type);
+      }
+    }
+  });
+  auto it = plans->find(descriptor);
+  if (it != plans->end()) return it->second;
+  // Any other message type.
+  static std::mutex *other_plans_mutex = new std::mutex;
+  static PlanMap *other_plans = new PlanMap;
+  std::lock_guard<std::mutex> lock(*other_plans_mutex);
+  const MessagePlan *&plan = (*other_plans)[descriptor];
+  if (plan == NULL) plan = MakeMessagePlan(descriptor);
+  return plan;
+}
+
+// The serialization of all the values of a field, without a trailing space, as
+// an acceptor from state 0 to state end. It is built once and then grafted
+// wherever the field may come next.
+struct ProtobufSerializer::Fragment {
+  MutableTransducer fst;
+  StateId end;
+  bool optional;
+};
+
 void ProtobufSerializer::SerializeToFst() {
   fst_->DeleteStates();
   fst_->AddState();
@@ -89,148 +239,317 @@ void ProtobufSerializer::SerializeToFst() {
 
 StateId ProtobufSerializer::SerializeToFstInternal() {
   FieldDescriptorVector fields;
-  reflection_->ListFields(*message_, &fields);
-  if (fields.empty()) {
+  if (plan_->generated != NULL) {
+    plan_->generated->ListFields(*message_, &fields);
+  } else {
+    reflection_->ListFields(*message_, &fields);
+  }
+  // field_order only directs the serialization, and is never serialized itself.
+  bool has_field_order = false;
+  bool has_preserve_order = false;
+  FieldDescriptorVector serialized_fields;
+  for (const FieldDescriptor *field : fields) {
+    if (field == plan_->field_order_field) {
+      has_field_order = true;
+      continue;
+    }
+    if (field == plan_->preserve_order_field) has_preserve_order = true;
+    serialized_fields.push_back(field);
+  }
+  if (serialized_fields.empty()) {
     return initial_state_;  // nothing to do
   }
-  // add one extra state to link all the permutations up to.
-  StateId finish = fst_->AddState();
-  FieldDescriptorVector::const_iterator it =
-      std::find_if(fields.begin(),
-                   fields.end(),
-                   FindFieldByName("preserve_order"));
   bool preserve_order = false;
-  const FieldDescriptor *preserve_order_field = NULL;
-  if (it != fields.end()) {
-    preserve_order = reflection_->GetBool(*message_, *it);
-    preserve_order_field = *it;
+  if (has_preserve_order) {
+    preserve_order =
+        reflection_->GetBool(*message_, plan_->preserve_order_field);
     // Check to make sure we have a field_order field. If we don't then set
     // truth to false.
-    it = std::find_if(fields.begin(),
-                      fields.end(),
-                      FindFieldByName("field_order"));
-    if (it == fields.end()) {
-        LOG(WARNING) << "preserve_order is true,"
-          << " but no field_order field defined for this message";
+    if (preserve_order && !has_field_order) {
+      LOG(WARNING) << "preserve_order is true,"
+                   << " but no field_order field defined for this message";
       preserve_order = false;
     }
   }
   if (preserve_order) {
     const Descriptor *descriptor = message_->GetDescriptor();
-    FieldDescriptorVector fields2;
-    for (int i = 0, n = reflection_->FieldSize(*message_, *it); i < n; ++i) {
-      const string name = reflection_->GetRepeatedString(*message_, *it, i);
+    FieldDescriptorVector ordered_fields;
+    string scratch;
+    for (int i = 0,
+             n = reflection_->FieldSize(*message_, plan_->field_order_field);
+         i < n; ++i) {
+      const string &name = reflection_->GetRepeatedStringReference(
+          *message_, plan_->field_order_field, i, &scratch);
       const FieldDescriptor *field = descriptor->FindFieldByName(name);
       if (field == NULL) {
         // Shouldn't happen - would indicate that ProtobufParser had found a
         // field name which we can't find again now.
         LOG(ERROR) << "Couldn't find field " << name;
       } else {
-        fields2.push_back(field);
+        ordered_fields.push_back(field);
       }
     }
-    fields2.push_back(preserve_order_field);
-    SerializePermutation(fields2);
-    StripTrailingSpace(finish);
-  } else {
-    OrderByFieldNumber comp;
-    int count = 0;
-    do {
-      SerializePermutation(fields);
-      StripTrailingSpace(finish);
-    // TODO(nielse): Remove hack for b/17619322: The complexity of this code is
-    // factorial in the number of fields, therefore we limit it to 5040
-    // permutations, which is enough for 7 fields (7! = 5040).
-    // With more than seven fields we always have at least the standard
-    // ordering based on field number.
-    } while (std::next_permutation(fields.begin(), fields.end(), comp) &&
-             ++count < 5040);
+    ordered_fields.push_back(plan_->preserve_order_field);
+    return SerializeInOrder(ordered_fields);
   }
-  return finish;
+  if (serialized_fields.size() > max_any_order_fields_) {
+    if (!plan_->warned_too_many_fields.exchange(true)) {
+      LOG(WARNING) << "Serializing the fields of "
+                   << message_->GetDescriptor()->full_name()
+                   << " in field number order only when more than "
+                   << max_any_order_fields_ << " of them are set";
+    }
+    // ListFields() returns them in field number order.
+    return SerializeInOrder(serialized_fields);
+  }
+  return SerializeInAnyOrder(serialized_fields);
 }
 
-void ProtobufSerializer::SerializePermutation(
+// Each field is followed by a space unless it is the last one. So the states
+// between the fields record whether anything has been output yet, which can
+// only be false while every field so far was an optional one that was left
+// out.
+StateId ProtobufSerializer::SerializeInOrder(
     const FieldDescriptorVector &fields) {
-  StateId state = initial_state_;
-  for (int i = 0; i < fields.size(); ++i) {
-    const FieldDescriptor *field = fields[i];
-    // Never serialize field_order
-    // TODO(rws): one inefficiency here is that we do all the sorting and
-    // permuting with the field orders entry there, then we simply ignore
-    // it. 'Twould be better an 'twere there to begin with. As it is it not
-    // wrong, merely redundant.
-    if (field->name() == "field_order") {
-      continue;
-    } else if (field->is_repeated()) {
-      // repeated fields have to be handled slightly separately, and we
-      // obviously don't generate permutations for them since order typically
-      // is important.
-      const int n = reflection_->FieldSize(*message_, field);
-      for (int j = 0; j < n; ++j) {
-        state = SerializeField(field, j, state);
+  StateId emitted = fst::kNoStateId;
+  StateId none = initial_state_;
+  Fragment fragment;
+  for (const FieldDescriptor *field : fields) {
+    SerializeFragment(field, &fragment);
+    const StateId next_emitted = fst_->AddState();
+    if (none != fst::kNoStateId) {
+      GraftFragment(fragment, none, next_emitted);
+    }
+    if (emitted != fst::kNoStateId) {
+      GraftFragment(fragment, SerializeChar(' ', emitted), next_emitted);
+      if (fragment.optional) {
+        fst_->AddArc(emitted,
+                     Arc(0, 0, kSkipOptionalFieldCost, next_emitted));
       }
-    } else {
-      state = SerializeField(field, -1, state);
     }
+    if (!fragment.optional) none = fst::kNoStateId;
+    emitted = next_emitted;
   }
+  return JoinFinalStates(emitted, none);
 }
 
-void ProtobufSerializer::StripTrailingSpace(StateId new_final_state) {
-  for (int state = fst_->NumStates() - 1; state > 0; --state) {
-    MutableArcIterator aiter(fst_, state);
-    if (!aiter.Done() && aiter.Value().olabel != ' ') {
-      Arc value = aiter.Value();
-      fst_->AddArc(value.nextstate, Arc(0, 0, Weight::One(), new_final_state));
-      return;
+// Serializes the fields in every order at once. Instead of a path for each of
+// the n! orderings, there is a state for each subset of the fields that has
+// been output so far, so the number of states grows as 2^n.
+StateId ProtobufSerializer::SerializeInAnyOrder(
+    const FieldDescriptorVector &fields) {
+  const int num_fields = fields.size();
+  std::vector<Fragment> fragments(num_fields);
+  for (int i = 0; i < num_fields; ++i) {
+    SerializeFragment(fields[i], &fragments[i]);
+  }
+  const int num_subsets = 1 << num_fields;
+  // As in SerializeInOrder(), whether anything has been output yet.
+  std::vector<StateId> emitted(num_subsets, fst::kNoStateId);
+  std::vector<StateId> none(num_subsets, fst::kNoStateId);
+  none[0] = initial_state_;
+  auto get_state = [this](std::vector<StateId> *states, int subset) {
+    if ((*states)[subset] == fst::kNoStateId) {
+      (*states)[subset] = fst_->AddState();
+    }
+    return (*states)[subset];
+  };
+  // Adding a field always leads to a larger subset, so all the arcs into a
+  // subset's states are in place by the time it is reached.
+  for (int subset = 0; subset < num_subsets - 1; ++subset) {
+    if (none[subset] != fst::kNoStateId) {
+      for (int i = 0; i < num_fields; ++i) {
+        if (subset & (1 << i)) continue;
+        const int next_subset = subset | (1 << i);
+        GraftFragment(fragments[i], none[subset],
+                      get_state(&emitted, next_subset));
+        if (fragments[i].optional) {
+          fst_->AddArc(none[subset],
+                       Arc(0, 0, kSkipOptionalFieldCost,
+                           get_state(&none, next_subset)));
+        }
+      }
+    }
+    if (emitted[subset] != fst::kNoStateId) {
+      const StateId space = SerializeChar(' ', emitted[subset]);
+      for (int i = 0; i < num_fields; ++i) {
+        if (subset & (1 << i)) continue;
+        const int next_subset = subset | (1 << i);
+        GraftFragment(fragments[i], space, get_state(&emitted, next_subset));
+        if (fragments[i].optional) {
+          fst_->AddArc(emitted[subset],
+                       Arc(0, 0, kSkipOptionalFieldCost,
+                           get_state(&emitted, next_subset)));
+        }
+      }
     }
   }
+  return JoinFinalStates(emitted[num_subsets - 1], none[num_subsets - 1]);
 }
 
-StateId ProtobufSerializer::SerializeField(const FieldDescriptor *field,
-                                           int index,
-                                           StateId state) {
-  if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
-    state = SerializeString(field->name() + " { ", state);
-    const Message *submessage;
-    if (index == -1) {
-      submessage = &reflection_->GetMessage(*message_, field);
-    } else {
-      submessage = &reflection_->GetRepeatedMessage(*message_, field, index);
+void ProtobufSerializer::SerializeFragment(const FieldDescriptor *field,
+                                           Fragment *fragment) const {
+  // Extensions are not among the fields of the message type.
+  FieldPlan extension_plan;
+  const FieldPlan *plan = &extension_plan;
+  if (field->is_extension()) {
+    MakeFieldPlan(field, &extension_plan);
+  } else {
+    plan = &plan_->fields[field->index()];
+  }
+  fragment->fst.DeleteStates();
+  fragment->fst.SetStart(fragment->fst.AddState());
+  ProtobufSerializer serializer(message_, &fragment->fst, 0);
+  serializer.set_max_any_order_fields(max_any_order_fields_);
+  StateId state = 0;
+  if (field->is_repeated()) {
+    // We obviously don't generate orderings of the values of repeated fields,
+    // since their order typically is important.
+    const int n = plan_->generated != NULL ?
+        plan_->generated->FieldSize(*message_, field) :
+        reflection_->FieldSize(*message_, field);
+    for (int j = 0; j < n; ++j) {
+      if (j > 0) state = serializer.SerializeChar(' ', state);
+      state = serializer.SerializeField(*plan, j, state);
     }
-    ProtobufSerializer serializer(submessage, fst_, state);
-    state = serializer.SerializeToFstInternal();
-    return SerializeString(" } ", state);
   } else {
-    const StateId initial_state = state;
-    const string name = field->name();
-    state = SerializeString(name + ": ", state);
+    state = serializer.SerializeField(*plan, -1, state);
+  }
+  fragment->end = state;
+  fragment->optional = plan->optional;
+}
+
+void ProtobufSerializer::GraftFragment(const Fragment &fragment,
+                                       StateId from,
+                                       StateId to) {
+  // Nothing leads back into the start of a fragment or out of its end, so they
+  // can be merged with from and to.
+  std::vector<StateId> state_map(fragment.fst.NumStates(), fst::kNoStateId);
+  state_map[0] = from;
+  state_map[fragment.end] = to;
+  for (StateId state = 0; state < state_map.size(); ++state) {
+    if (state_map[state] == fst::kNoStateId) {
+      state_map[state] = fst_->AddState();
+    }
+  }
+  for (StateId state = 0; state < state_map.size(); ++state) {
+    for (ArcIterator aiter(fragment.fst, state); !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      fst_->AddArc(state_map[state],
+                   Arc(arc.ilabel, arc.olabel, arc.weight,
+                       state_map[arc.nextstate]));
+    }
+  }
+}
+
+StateId ProtobufSerializer::JoinFinalStates(StateId emitted, StateId none) {
+  if (none == fst::kNoStateId) return emitted;
+  const StateId finish = fst_->AddState();
+  fst_->AddArc(emitted, Arc(0, 0, Weight::One(), finish));
+  fst_->AddArc(none, Arc(0, 0, Weight::One(), finish));
+  return finish;
+}
+
+StateId ProtobufSerializer::SerializeField(const FieldPlan &plan,
+                                           int index,
+                                           StateId state) {
+  const FieldDescriptor *field = plan.field;
+  const bool repeated = index != -1;
+  state = SerializeString(plan.prefix, state);
+  const MessageFields *generated = plan_->generated;
+  if (generated != NULL && !field->is_extension()) {
     string value;
-    if (field->type() == FieldDescriptor::TYPE_STRING) {
+    switch (plan.kind) {
+      case FieldPlan::MESSAGE:
+        return SerializeMessage(generated->GetMessage(*message_, field, index),
+                                state);
+      case FieldPlan::STRING:
+        return SerializeQuotedString(
+            generated->GetString(*message_, field, index, &value), state);
+      default:
+        if (generated->AppendValue(*message_, field, index, &value)) {
+          return SerializeChars(value.data(), value.size(), state);
+        }
+        break;
+    }
+  }
+  // Large enough for any 64-bit integer.
+  char number[24];
+  switch (plan.kind) {
+    case FieldPlan::MESSAGE:
+      return SerializeMessage(
+          repeated ? reflection_->GetRepeatedMessage(*message_, field, index) :
+                     reflection_->GetMessage(*message_, field),
+          state);
+    case FieldPlan::STRING: {
       // Special handling for string fields, where we don't escape internal
       // quotes with backslashes. This can't be disabled in TextFormat::Printer.
-      if (index == -1) {
-        value = "\"" + reflection_->GetString(*message_, field) + "\"";
-      } else {
-        value = "\"" +
-            reflection_->GetRepeatedString(*message_, field, index) + "\"";
-      }
-    } else {
-      google::protobuf::TextFormat::Printer printer;
-      printer.SetUseUtf8StringEscaping(true);
-      printer.PrintFieldValueToString(*message_, field, index, &value);
+      string scratch;
+      const string &value = repeated ?
+          reflection_->GetRepeatedStringReference(*message_, field, index,
+                                                  &scratch) :
+          reflection_->GetStringReference(*message_, field, &scratch);
+      return SerializeQuotedString(value, state);
     }
-    StateId lastend = SerializeString(value, state);
-    lastend = SerializeChar(' ', lastend);
-
-    // Serialize morphosyntatic_features fields optionally, so languages which
-    // don't use them can still consume inputs with them.
-    if (field->name() == "morphosyntactic_features") {
-      fst_->AddArc(initial_state, Arc(0, 0, 1.0, lastend));
+    case FieldPlan::ENUM:
+      return SerializeString(
+          (repeated ? reflection_->GetRepeatedEnum(*message_, field, index) :
+                      reflection_->GetEnum(*message_, field))->name(),
+          state);
+    case FieldPlan::BOOL:
+      if (repeated ? reflection_->GetRepeatedBool(*message_, field, index) :
+                     reflection_->GetBool(*message_, field)) {
+        return SerializeChars("true", 4, state);
+      }
+      return SerializeChars("false", 5, state);
+    case FieldPlan::INT32:
+      return SerializeChars(
+          number,
+          snprintf(number, sizeof(number), "%d",
+                   repeated ?
+                   reflection_->GetRepeatedInt32(*message_, field, index) :
+                   reflection_->GetInt32(*message_, field)),
+          state);
+    case FieldPlan::INT64:
+      return SerializeChars(
+          number,
+          snprintf(number, sizeof(number), "%lld",
+                   static_cast<long long>(repeated ?
+                   reflection_->GetRepeatedInt64(*message_, field, index) :
+                   reflection_->GetInt64(*message_, field))),
+          state);
+    case FieldPlan::UINT32:
+      return SerializeChars(
+          number,
+          snprintf(number, sizeof(number), "%u",
+                   repeated ?
+                   reflection_->GetRepeatedUInt32(*message_, field, index) :
+                   reflection_->GetUInt32(*message_, field)),
+          state);
+    case FieldPlan::UINT64:
+      return SerializeChars(
+          number,
+          snprintf(number, sizeof(number), "%llu",
+                   static_cast<unsigned long long>(repeated ?
+                   reflection_->GetRepeatedUInt64(*message_, field, index) :
+                   reflection_->GetUInt64(*message_, field))),
+          state);
+    default: {
+      string value;
+      ValuePrinter().PrintFieldValueToString(*message_, field, index, &value);
+      return SerializeString(value, state);
     }
-    return lastend;
   }
 }
 
+StateId ProtobufSerializer::SerializeMessage(const Message &message,
+                                             StateId state) {
+  ProtobufSerializer serializer(&message, fst_, state);
+  serializer.set_max_any_order_fields(max_any_order_fields_);
+  state = serializer.SerializeToFstInternal();
+  return SerializeChars(kMessageSuffix, sizeof(kMessageSuffix) - 1, state);
+}
+
 StateId ProtobufSerializer::SerializeString(const string &str, StateId state) {
   return SerializeString(str, state, false);
 }
@@ -260,6 +579,28 @@ StateId ProtobufSerializer::SerializeString(const string &str,
   return state;
 }
 
+StateId ProtobufSerializer::SerializeQuotedString(const string &str,
+                                                  StateId state) {
+  // As SerializeString() of the quoted string, including the alternate
+  // serialization without the quotes.
+  const StateId first_state = state;
+  state = SerializeChar('"', state);
+  state = SerializeChars(str.data(), str.size(), state);
+  state = SerializeChar('"', state);
+  const StateId end_state = SerializeString(str, first_state);
+  fst_->AddArc(end_state, Arc(0, 0, Weight::One(), state));
+  return state;
+}
+
+StateId ProtobufSerializer::SerializeChars(const char *str,
+                                           size_t size,
+                                           StateId state) {
+  for (size_t i = 0; i < size; ++i) {
+    state = SerializeChar(str[i], state);
+  }
+  return state;
+}
+
 StateId ProtobufSerializer::SerializeChar(char c, StateId state) {
   // TODO(pebden): Same comments as above apply re byte-oriented FSTs.
   const StateId next_state = fst_->AddState();
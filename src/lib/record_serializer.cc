@@ -23,9 +23,8 @@ using std::vector;
 #include <google/protobuf/message.h>
 #include <sparrowhawk/items.pb.h>
 #include <sparrowhawk/serialization_spec.pb.h>
-#include <sparrowhawk/field_path.h>
+#include <sparrowhawk/field_trie.h>
 #include <sparrowhawk/string_utils.h>
-#include <re2/re2.h>
 
 namespace speech {
 namespace sparrowhawk {
@@ -38,38 +37,43 @@ using google::protobuf::Message;
 namespace {
 
 const char kLabelSeparator[] = ":";
-const char kEscapedEscape[] = R"(\\)";
+const char kEscapeCharacter = '\\';
 const char kRecordSeparator[] = "|";
+// The characters escaped in values: the escape character and the record
+// separator.
+const char kEscapedCharacters[] = "\\|";
 
-}  // namespace
+// Each prefix and suffix of a set field adds this cost to the serialization,
+// whether or not it has any records.
+const float kAffixCost = 1;
 
-RecordSerializer::RecordSerializer()
-    : escape_re_(string("(") +
-                 string(kEscapedEscape) +
-                 string(R"()|(\)") +
-                 string(kRecordSeparator) +
-                 string(")")),
-      escape_replacement_(string(kEscapedEscape) + string(R"(\0)")),
-      string_compiler_(fst::StringTokenType::BYTE) {}
+// Adds cost to the path of fst that ends in its last state.
+void AddCost(float cost, RecordSerializer::MutableTransducer *fst) {
+  const auto state = fst->NumStates() - 1;
+  fst->SetFinal(state,
+                fst::Times(fst->Final(state), fst::TropicalWeight(cost)));
+}
+
+}  // namespace
 
 std::unique_ptr<RecordSerializer> RecordSerializer::Create(
-    const RecordSpec &record_spec) {
+    const RecordSpec &record_spec, FieldTrie *trie) {
   std::unique_ptr<RecordSerializer> record_serializer(new RecordSerializer());
 
   // Adds field path, label and default from the spec.
-  record_serializer->field_path_ = FieldPath::Create(Token::descriptor());
-  if (!record_serializer->field_path_->Parse(record_spec.field_path())) {
+  if (!trie->AddPath(record_spec.field_path(), &record_serializer->field_)) {
     LOG(ERROR) << "FieldPath failed to parse for record spec: "
                << record_spec.field_path();
     return nullptr;
   }
   if (record_spec.has_label()) {
-    record_serializer->field_name_ = record_spec.label();
+    record_serializer->record_label_ = record_spec.label();
   } else {
     std::vector<string> vector_path =
         SplitString(record_spec.field_path(), ".");
-    record_serializer->field_name_ = vector_path.back();
+    record_serializer->record_label_ = vector_path.back();
   }
+  record_serializer->record_label_ += kLabelSeparator;
   if (record_spec.has_default_value()) {
     record_serializer->default_value_ = record_spec.default_value();
     if (record_serializer->default_value_.empty()) {
@@ -81,7 +85,7 @@ std::unique_ptr<RecordSerializer> RecordSerializer::Create(
 
   // Adds record serializers for prefix and suffix records.
   for (const RecordSpec &prefix_spec : record_spec.prefix_spec()) {
-    auto prefix_serializer = RecordSerializer::Create(prefix_spec);
+    auto prefix_serializer = RecordSerializer::Create(prefix_spec, trie);
     if (prefix_serializer) {
       record_serializer->prefix_serializers_.push_back(
           std::move(prefix_serializer));
@@ -90,7 +94,7 @@ std::unique_ptr<RecordSerializer> RecordSerializer::Create(
     }
   }
   for (const RecordSpec &suffix_spec : record_spec.suffix_spec()) {
-    auto suffix_serializer = RecordSerializer::Create(suffix_spec);
+    auto suffix_serializer = RecordSerializer::Create(suffix_spec, trie);
     if (suffix_serializer) {
       record_serializer->suffix_serializers_.push_back(
           std::move(suffix_serializer));
@@ -101,19 +105,46 @@ std::unique_ptr<RecordSerializer> RecordSerializer::Create(
   return record_serializer;
 }
 
-void RecordSerializer::SerializeRecord(string *value,
+void RecordSerializer::AppendBytes(const char *bytes, size_t size,
+                                   MutableTransducer *fst) {
+  StateId state = fst->NumStates() - 1;
+  // The cost of the path so far stays on its last state.
+  const Weight final_weight = fst->Final(state);
+  fst->SetFinal(state, Weight::Zero());
+  for (size_t i = 0; i < size; ++i) {
+    const StateId nextstate = fst->AddState();
+    const Arc::Label label = static_cast<unsigned char>(bytes[i]);
+    fst->AddArc(state, Arc(label, label, Weight::One(), nextstate));
+    state = nextstate;
+  }
+  fst->SetFinal(state, final_weight);
+}
+
+void RecordSerializer::AppendString(const string &bytes,
+                                    MutableTransducer *fst) {
+  AppendBytes(bytes.data(), bytes.size(), fst);
+}
+
+void RecordSerializer::AppendEscaped(const string &value,
+                                     MutableTransducer *fst) {
+  size_t begin = 0;
+  size_t end;
+  while ((end = value.find_first_of(kEscapedCharacters, begin)) !=
+         string::npos) {
+    AppendBytes(value.data() + begin, end - begin, fst);
+    AppendBytes(&kEscapeCharacter, 1, fst);
+    AppendBytes(value.data() + end, 1, fst);
+    begin = end + 1;
+  }
+  AppendBytes(value.data() + begin, value.size() - begin, fst);
+}
+
+void RecordSerializer::SerializeRecord(const string &value,
                                        MutableTransducer *fst) const {
-  // Adds a label for the field_name.
-  string_compiler_(field_name_ + kLabelSeparator, fst);
-  // Escapes record_separator and escape_character in value.
-  RE2::GlobalReplace(value, escape_re_, escape_replacement_);
-  MutableTransducer fst_value;
-  string_compiler_(*value, &fst_value);
-  Concat(fst, fst_value);
+  AppendString(record_label_, fst);
+  AppendEscaped(value, fst);
   // Adds a record_separator to terminate the record.
-  MutableTransducer record_separator_fst;
-  string_compiler_(kRecordSeparator, &record_separator_fst);
-  Concat(fst, record_separator_fst);
+  AppendString(kRecordSeparator, fst);
 }
 
 bool RecordSerializer::SerializeToFstRepeated(const Message &parent,
@@ -179,7 +210,7 @@ bool RecordSerializer::SerializeToFstRepeated(const Message &parent,
       return false;
     }
   }
-  SerializeRecord(&value, fst);
+  SerializeRecord(value, fst);
   return true;
 }
 
@@ -239,65 +270,44 @@ bool RecordSerializer::SerializeToFst(const Message &parent,
       return false;
     }
   }
-  SerializeRecord(&value, fst);
+  SerializeRecord(value, fst);
   return true;
 }
 
-bool RecordSerializer::SerializeAffixes(const Token &token,
-                                        MutableTransducer *prefix_fst,
-                                        MutableTransducer *suffix_fst) const {
-  prefix_fst->SetStart(prefix_fst->AddState());
-  prefix_fst->SetFinal(0, 1);
-  for (const auto &prefix_serializer : prefix_serializers_) {
-     if (!prefix_serializer->Serialize(token, prefix_fst)) {
-       return false;
-     }
-  }
-  suffix_fst->SetStart(suffix_fst->AddState());
-  suffix_fst->SetFinal(0, 1);
-  for (const auto &suffix_serializer : suffix_serializers_) {
-     if (!suffix_serializer->Serialize(token, suffix_fst)) {
+bool RecordSerializer::SerializeAffix(
+    FieldTrie::Messages *messages,
+    const std::vector<std::unique_ptr<RecordSerializer>> &affix_serializers,
+    MutableTransducer *fst) {
+  AddCost(kAffixCost, fst);
+  for (const auto &affix_serializer : affix_serializers) {
+     if (!affix_serializer->Serialize(messages, fst)) {
        return false;
      }
   }
   return true;
 }
 
-bool RecordSerializer::Serialize(const Token &token,
+bool RecordSerializer::Serialize(FieldTrie::Messages *messages,
                                  MutableTransducer *fst) const {
-  const Message *parent;
-  const FieldDescriptor *field;
-  if (!field_path_->Follow(token, &parent, &field)) {
-    LOG(ERROR) << "FieldPath traversal failed for input Message "
-               << token.DebugString();
-    return false;
-  }
-
   // Checks whether the field being serialized is not set (it is known that it
   // must be a valid field as it parses) in the token, and returns without
   // modifying the fst in this case.
+  const FieldDescriptor *field = field_.descriptor;
   int field_size;
   bool repeated_field = field->label() == FieldDescriptor::LABEL_REPEATED;
   if (repeated_field) {
-    field_size = parent->GetReflection()->FieldSize(*parent, field);
+    field_size = messages->FieldSize(field_);
     if (field_size == 0) {
       return true;
     }
-  } else if (!parent->GetReflection()->HasField(*parent, field)) {
-    if (!default_value_.empty()) {
-      string value = default_value_;
-      MutableTransducer serialization;
-      SerializeRecord(&value, &serialization);
-      Concat(fst, serialization);
-    }
+  } else if (!messages->IsSet(field_)) {
+    if (!default_value_.empty()) SerializeRecord(default_value_, fst);
     return true;
   }
+  const Message *parent = &messages->Get(field_.parent);
 
-  MutableTransducer prefix_fst, suffix_fst;
-  if (!SerializeAffixes(token, &prefix_fst, &suffix_fst)) {
-     return false;
-  }
-  std::vector<MutableTransducer> serializations;
+  // The affixes are serialized again for each value of a repeated field,
+  // rather than built once and copied.
   if (repeated_field) {
     if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
       LOG(ERROR) << "Intermediate repeated message not allowed in field_path, "
@@ -305,23 +315,19 @@ bool RecordSerializer::Serialize(const Token &token,
       return false;
     } else {
       for (int i = 0; i < field_size; ++i) {
-        Concat(fst, prefix_fst);
-        MutableTransducer serialization;
-        if (!SerializeToFstRepeated(*parent, *field, i, &serialization)) {
+        if (!SerializeAffix(messages, prefix_serializers_, fst) ||
+            !SerializeToFstRepeated(*parent, *field, i, fst) ||
+            !SerializeAffix(messages, suffix_serializers_, fst)) {
           return false;
         }
-        Concat(fst, serialization);
-        Concat(fst, suffix_fst);
       }
     }
   } else {
-    Concat(fst, prefix_fst);
-    MutableTransducer serialization;
-    if (!SerializeToFst(*parent, *field, &serialization)) {
+    if (!SerializeAffix(messages, prefix_serializers_, fst) ||
+        !SerializeToFst(*parent, *field, fst) ||
+        !SerializeAffix(messages, suffix_serializers_, fst)) {
       return false;
     }
-    Concat(fst, serialization);
-    Concat(fst, suffix_fst);
   }
   return true;
 }
@@ -13,9 +13,18 @@
 // Copyright 2015 and onwards Google, Inc.
 #include <sparrowhawk/rule_system.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+using std::vector;
+
+#include <fst/extensions/mpdt/mpdtlib.h>
+#include <fst/extensions/pdt/pdtlib.h>
 #include <google/protobuf/text_format.h>
 #include <sparrowhawk/io_utils.h>
 #include <sparrowhawk/logger.h>
+#include <sparrowhawk/thread_pool.h>
 
 namespace speech {
 namespace sparrowhawk {
@@ -23,102 +32,707 @@ namespace sparrowhawk {
 using fst::LabelLookAheadRelabeler;
 using fst::StdArc;
 
-RuleSystem::~RuleSystem() {
-  std::map<string, LookaheadFst*>::iterator iter;
-  for (iter = lookaheads_.begin(); iter != lookaheads_.end(); iter++) {
-    delete iter->second;
+namespace {
+
+// Identifies a grammar cache file, and changes with its format.
+const int32 kCacheMagicNumber = 0x53484333;  // "SHC3"
+
+// Whether the rules of grammar can be composed into one ahead of time.
+bool CanPrecompose(const Grammar& grammar) {
+  if (grammar.rules_size() < 2) return false;
+  for (int i = 0; i < grammar.rules_size(); ++i) {
+    const Rule &rule = grammar.rules(i);
+    if (rule.has_parens() || rule.has_assignments() || rule.has_redup()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The name under which the composition of the rules of grammar is cached. It
+// lists the rules, so a cached composition is not used once they change.
+string PrecomposedRuleName(const Grammar& grammar) {
+  string name = "<precomposed>";
+  for (int i = 0; i < grammar.rules_size(); ++i) {
+    name += (i == 0 ? ":" : ",") + grammar.rules(i).main();
   }
+  return name;
 }
 
+}  // namespace
+
+const char RuleSystem::kCacheSuffix[] = ".cache";
+
+RuleSystem::~RuleSystem() { }
+
 bool RuleSystem::LoadGrammar(const string& filename, const string& prefix) {
   // This is the contents of filename.
   string proto_string = IOStream::LoadFileToString(prefix + filename);
   if (!google::protobuf::TextFormat::ParseFromString(proto_string, &grammar_))
     return false;
-  string grm_file = prefix + grammar_.grammar_file();
+  grm_file_ = prefix + grammar_.grammar_file();
   grammar_name_ = grammar_.grammar_name();
-  grm_.reset(new GrmManager);
-  if (!grm_->LoadArchive(grm_file)) {
-    LoggerError("Error loading archive \"%s\" from \"%s\"",
-                grammar_name_.c_str(), grm_file.c_str());
-    return false;
+  // The rules as the grammar lists them. When they are precomposed, grammar_
+  // is left with the single rule that replaces them.
+  const Grammar cascade(grammar_);
+  const bool precompose = grammar_.precompose() && CanPrecompose(grammar_);
+  if (grammar_.precompose() && !precompose) {
+    LoggerWarn("Not precomposing the rules of \"%s\", which need applying "
+               "one at a time", grammar_name_.c_str());
+  }
+  precomposed_.reset();
+  precomposed_name_.clear();
+  if (precompose) {
+    precomposed_name_ = PrecomposedRuleName(cascade);
+    grammar_.clear_rules();
+    grammar_.add_rules()->set_main(precomposed_name_);
+  }
+  if (prepare_lookaheads_ || memory_map_ || precompose) LoadCache();
+  if (!HasMappedRules()) {
+    mapped_rules_.clear();
+    grm_.reset(new GrmManager);
+    if (!grm_->LoadArchive(grm_file_)) {
+      LoggerError("Error loading archive \"%s\" from \"%s\"",
+                  grammar_name_.c_str(), grm_file_.c_str());
+      return false;
+    }
   }
   // Verifies that the rules named in the rule ordering all exist in the
-  // grammar.
-  for (int i = 0; i < grammar_.rules_size(); ++i) {
-    Rule rule = grammar_.rules(i);
-    if (grm_->GetFst(rule.main()) == NULL) {
+  // grammar. Rules served from the cache are the ones that get applied.
+  const Grammar& checked = grm_ != nullptr ? cascade : grammar_;
+  for (int i = 0; i < checked.rules_size(); ++i) {
+    Rule rule = checked.rules(i);
+    if (FindRule(rule.main()) == NULL) {
       LoggerError("Rule \"%s\" not found in \"%s\"",
                   rule.main().c_str(), grammar_name_.c_str());
       return false;
     }
-    if (rule.has_parens() && grm_->GetFst(rule.parens()) == NULL) {
+    if (rule.has_parens() && FindRule(rule.parens()) == NULL) {
       LoggerError("Rule \"%s\" not found in \"%s\"",
                   rule.parens().c_str(), grammar_name_.c_str());
       return false;
     }
-    if (rule.has_redup() && grm_->GetFst(rule.redup()) == NULL) {
+    if (rule.has_assignments() && FindRule(rule.assignments()) == NULL) {
+      LoggerError("Rule \"%s\" not found in \"%s\"",
+                  rule.assignments().c_str(), grammar_name_.c_str());
+      return false;
+    }
+    if (rule.has_redup() && FindRule(rule.redup()) == NULL) {
       LoggerError("Rule \"%s\" not found in \"%s\"",
                   rule.redup().c_str(), grammar_name_.c_str());
       return false;
     }
   }
+  // The composition is only done here when the cache did not have it.
+  if (precompose && grm_ != nullptr && precomposed_ == nullptr &&
+      !Precompose(cascade)) {
+    return false;
+  }
+  if (!PreparePdtRules()) return false;
+  PrepareRedupFilters();
+  // Whatever lookaheads the cache lacked are built from the grammar.
+  if (prepare_lookaheads_ && !BuildLookaheads()) return false;
+  relabel_tables_.clear();
+  for (const auto &lookahead : lookaheads_) {
+    relabel_tables_[lookahead.first].reset(
+        new RelabelTable(*lookahead.second));
+  }
   return true;
 }
 
-bool RuleSystem::ApplyRules(const Transducer& input,
-                            MutableTransducer* output,
-                            bool use_lookahead) const {
-  MutableTransducer mutable_input(input);
+const StdArc::Label RuleSystem::RelabelTable::kMaxDenseLabel;
+
+RuleSystem::RelabelTable::RelabelTable(const LookaheadFst& lookahead_fst) {
+  std::vector<std::pair<StdArc::Label, StdArc::Label>> pairs;
+  LabelLookAheadRelabeler<StdArc>::RelabelPairs(lookahead_fst, &pairs);
+  StdArc::Label max_label = 0;
+  StdArc::Label max_index = 0;
+  for (const auto &pair : pairs) {
+    max_label = std::max(max_label, pair.first);
+    max_index = std::max(max_index, pair.second);
+  }
+  // The indices run from 1 to one past the largest in pairs, which is left
+  // out of them for the final label. Labels the rule has not seen can share
+  // one more index, since none of them matches anything.
+  unknown_index_ = max_index + 2;
+  dense_.assign(std::min(max_label, kMaxDenseLabel) + 1, unknown_index_);
+  for (const auto &pair : pairs) {
+    if (pair.first < dense_.size()) {
+      dense_[pair.first] = pair.second;
+    } else {
+      sparse_.push_back(pair);
+    }
+  }
+  dense_[0] = 0;
+  std::sort(sparse_.begin(), sparse_.end());
+}
+
+StdArc::Label RuleSystem::RelabelTable::Relabel(StdArc::Label label) const {
+  if (label < dense_.size()) return dense_[label];
+  const auto it = std::lower_bound(sparse_.begin(), sparse_.end(),
+                                   std::make_pair(label, StdArc::Label(0)));
+  return it != sparse_.end() && it->first == label ? it->second
+                                                   : unknown_index_;
+}
+
+void RuleSystem::RelabelTable::Relabel(MutableTransducer* fst) const {
+  for (StdArc::StateId state = 0; state < fst->NumStates(); ++state) {
+    for (fst::MutableArcIterator<MutableTransducer> aiter(fst, state);
+         !aiter.Done();
+         aiter.Next()) {
+      StdArc arc = aiter.Value();
+      arc.olabel = Relabel(arc.olabel);
+      aiter.SetValue(arc);
+    }
+  }
+}
+
+bool RuleSystem::UsesLookahead(int rule_index, bool use_lookahead) const {
+  // Only use lookahead on non (M)PDT's
+  return use_lookahead && prepare_lookaheads_ &&
+      pdt_rules_[rule_index] == nullptr;
+}
+
+bool RuleSystem::Precompose(const Grammar& cascade) {
+  MutableTransducer composed(*FindRule(cascade.rules(0).main()));
+  for (int i = 1; i < cascade.rules_size(); ++i) {
+    fst::ArcSort(&composed, fst::OLabelCompare<StdArc>());
+    MutableTransducer next;
+    fst::Compose(composed, *FindRule(cascade.rules(i).main()), &next);
+    composed = next;
+  }
+  fst::RmEpsilon(&composed);
+  // Encoding each label pair and weight as one label makes an unweighted
+  // acceptor, which can always be determinized, and keeps the paths, with
+  // their weights and input epsilons, as they were.
+  fst::EncodeMapper<StdArc> encoder(fst::kEncodeLabels | fst::kEncodeWeights,
+                                    fst::ENCODE);
+  fst::Encode(&composed, &encoder);
+  std::unique_ptr<MutableTransducer> optimized(new MutableTransducer);
+  fst::Determinize(composed, optimized.get());
+  fst::Minimize(optimized.get());
+  fst::Decode(optimized.get(), encoder);
+  fst::ArcSort(optimized.get(), fst::ILabelCompare<StdArc>());
+  if (optimized->Properties(fst::kError, false)) {
+    LoggerError("Failed to precompose the rules of \"%s\"",
+                grammar_name_.c_str());
+    return false;
+  }
+  precomposed_ = std::move(optimized);
+  return true;
+}
+
+bool RuleSystem::LoadCache() {
+  const string cache_file = grm_file_ + kCacheSuffix;
+  std::ifstream strm(cache_file.c_str(),
+                     std::ios_base::in | std::ios_base::binary);
+  // Not having a cache is not an error.
+  if (!strm) return false;
+  int32 magic_number = 0;
+  int64 cached_size = 0;
+  int64 cached_mtime = 0;
+  uint64 cached_fingerprint = 0;
+  fst::ReadType(strm, &magic_number);
+  fst::ReadType(strm, &cached_size);
+  fst::ReadType(strm, &cached_mtime);
+  fst::ReadType(strm, &cached_fingerprint);
+  if (!strm || magic_number != kCacheMagicNumber) {
+    LoggerWarn("Ignoring malformed grammar cache \"%s\"", cache_file.c_str());
+    return false;
+  }
+  // The size and modification time of the far are enough to tell that it has
+  // not changed, without reading it. Only a far of the same size that has been
+  // touched or copied since needs its contents checked.
+  int64 size = 0;
+  int64 mtime = 0;
+  uint64 fingerprint = 0;
+  if (!IOStream::StatFile(grm_file_, &size, &mtime) || size != cached_size ||
+      (mtime != cached_mtime &&
+       (!IOStream::FingerprintFile(grm_file_, &fingerprint) ||
+        fingerprint != cached_fingerprint))) {
+    LoggerWarn("Ignoring stale grammar cache \"%s\"", cache_file.c_str());
+    return false;
+  }
+  // The transducers were written aligned, so their arrays can be mapped
+  // straight from the file rather than read and copied. Mapped pages are
+  // shared with every other process that maps the same cache.
+  fst::FstReadOptions opts(cache_file);
+  opts.mode = fst::FstReadOptions::MAP;
+  std::map<string, std::unique_ptr<LookaheadFst>> lookaheads;
+  int32 num_lookaheads = 0;
+  fst::ReadType(strm, &num_lookaheads);
+  for (int32 i = 0; strm && i < num_lookaheads; ++i) {
+    string rule_name;
+    fst::ReadType(strm, &rule_name);
+    std::unique_ptr<LookaheadFst> lookahead_fst(LookaheadFst::Read(strm, opts));
+    if (lookahead_fst == nullptr) break;
+    lookaheads[rule_name] = std::move(lookahead_fst);
+  }
+  // The rules are read too when the grammar is precomposed, so that the
+  // composition is not done again. Unless memory_map_ is set, they are read
+  // into memory.
+  std::map<string, std::unique_ptr<const Transducer>> rules;
+  int32 num_rules = 0;
+  if (memory_map_ || !precomposed_name_.empty()) {
+    fst::FstReadOptions rule_opts(opts);
+    if (!memory_map_) rule_opts.mode = fst::FstReadOptions::READ;
+    fst::ReadType(strm, &num_rules);
+    for (int32 i = 0; strm && i < num_rules; ++i) {
+      string rule_name;
+      fst::ReadType(strm, &rule_name);
+      std::unique_ptr<const Transducer> rule_fst(
+          fst::ConstFst<StdArc>::Read(strm, rule_opts));
+      if (rule_fst == nullptr) break;
+      rules[rule_name] = std::move(rule_fst);
+    }
+  }
+  if (!strm || lookaheads.size() != num_lookaheads ||
+      rules.size() != num_rules) {
+    LoggerWarn("Ignoring malformed grammar cache \"%s\"", cache_file.c_str());
+    return false;
+  }
+  if (prepare_lookaheads_) lookaheads_.swap(lookaheads);
+  if (!memory_map_) {
+    const auto precomposed = rules.find(precomposed_name_);
+    if (precomposed != rules.end()) {
+      precomposed_ = std::move(precomposed->second);
+    }
+    rules.clear();
+  }
+  mapped_rules_.swap(rules);
+  return true;
+}
+
+bool RuleSystem::HasMappedRules() const {
+  if (mapped_rules_.empty()) return false;
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule &rule = grammar_.rules(i);
+    for (const string &rule_name :
+         {rule.main(), rule.parens(), rule.assignments(), rule.redup()}) {
+      if (!rule_name.empty() && mapped_rules_.count(rule_name) == 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool RuleSystem::SaveCache() const {
+  int64 size = 0;
+  int64 mtime = 0;
+  uint64 fingerprint = 0;
+  if (!IOStream::StatFile(grm_file_, &size, &mtime) ||
+      !IOStream::FingerprintFile(grm_file_, &fingerprint)) {
+    return false;
+  }
+  // Rules that can be served without the GrmManager.
+  std::vector<string> rule_names;
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule &rule = grammar_.rules(i);
+    for (const string &rule_name :
+         {rule.main(), rule.parens(), rule.assignments(), rule.redup()}) {
+      if (!rule_name.empty() &&
+          std::find(rule_names.begin(), rule_names.end(), rule_name) ==
+          rule_names.end()) {
+        rule_names.push_back(rule_name);
+      }
+    }
+  }
+  const string cache_file = grm_file_ + kCacheSuffix;
+  // Writes to a temporary file which then replaces the cache in one step, so
+  // that a process starting up meanwhile never reads a partial cache.
+  const string temp_file = cache_file + ".tmp";
+  {
+    std::ofstream strm(temp_file.c_str(),
+                       std::ios_base::out | std::ios_base::binary);
+    if (!strm) {
+      LoggerError("Error opening grammar cache \"%s\" for writing",
+                  temp_file.c_str());
+      return false;
+    }
+    fst::WriteType(strm, kCacheMagicNumber);
+    fst::WriteType(strm, size);
+    fst::WriteType(strm, mtime);
+    fst::WriteType(strm, fingerprint);
+    const fst::FstWriteOptions opts(cache_file,
+                                    true /* write_header */,
+                                    true /* write_isymbols */,
+                                    true /* write_osymbols */,
+                                    true /* align */);
+    fst::WriteType(strm, static_cast<int32>(lookaheads_.size()));
+    for (const auto &lookahead : lookaheads_) {
+      fst::WriteType(strm, lookahead.first);
+      lookahead.second->Write(strm, opts);
+    }
+    fst::WriteType(strm, static_cast<int32>(rule_names.size()));
+    for (const string &rule_name : rule_names) {
+      // Sorted so that composition needs no further preparation.
+      MutableTransducer sorted_fst(*FindRule(rule_name));
+      fst::ArcSort(&sorted_fst, fst::ILabelCompare<StdArc>());
+      fst::WriteType(strm, rule_name);
+      fst::ConstFst<StdArc>(sorted_fst).Write(strm, opts);
+    }
+    strm.flush();
+    if (!strm) {
+      LoggerError("Error writing grammar cache \"%s\"", temp_file.c_str());
+      std::remove(temp_file.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temp_file.c_str(), cache_file.c_str()) != 0) {
+    LoggerError("Error renaming \"%s\" to \"%s\"",
+                temp_file.c_str(), cache_file.c_str());
+    std::remove(temp_file.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool RuleSystem::BuildLookaheads() {
+  std::vector<string> rule_names;
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule &rule = grammar_.rules(i);
+    // Only non (M)PDT's use lookahead.
+    if (rule.has_parens()) continue;
+    if (lookaheads_.count(rule.main()) == 0 &&
+        std::find(rule_names.begin(), rule_names.end(), rule.main()) ==
+        rule_names.end()) {
+      rule_names.push_back(rule.main());
+    }
+  }
+  // Each rule is built independently, so they can be done in parallel.
+  std::vector<std::unique_ptr<LookaheadFst>> lookahead_fsts(rule_names.size());
+  ThreadPool pool(std::max(0, num_load_threads_ - 1));
+  pool.ParallelFor(rule_names.size(),
+                   [this, &rule_names, &lookahead_fsts](int i) {
+    lookahead_fsts[i].reset(new LookaheadFst(*FindRule(rule_names[i])));
+  });
+  for (int i = 0; i < rule_names.size(); ++i) {
+    if (lookahead_fsts[i]->Properties(fst::kError, false)) {
+      LoggerError("Failed to build lookahead FST for rule \"%s\" in \"%s\"",
+                  rule_names[i].c_str(), grammar_name_.c_str());
+      return false;
+    }
+    lookaheads_[rule_names[i]] = std::move(lookahead_fsts[i]);
+  }
+  return true;
+}
+
+namespace {
+
+// Reads every state and arc of fst, so that its pages are resident.
+void TouchFst(const Transducer &fst) {
+  StdArc::Label label_sum = 0;
+  for (fst::StateIterator<Transducer> siter(fst);
+       !siter.Done();
+       siter.Next()) {
+    for (fst::ArcIterator<Transducer> aiter(fst, siter.Value());
+         !aiter.Done();
+         aiter.Next()) {
+      label_sum += aiter.Value().ilabel + aiter.Value().olabel;
+    }
+  }
+  // Keeps the loops above from being optimized away.
+  volatile StdArc::Label sink = label_sum;
+  (void) sink;
+}
+
+}  // namespace
+
+void RuleSystem::Warmup() const {
   for (int i = 0; i < grammar_.rules_size(); ++i) {
-    Rule rule = grammar_.rules(i);
-    if (rule.has_redup()) {
-      const string& redup_rule = rule.redup();
-      MutableTransducer redup1;
-      // Not an error if it fails.
-      if (grm_->Rewrite(redup_rule, mutable_input, &redup1, "")) {
-        MutableTransducer redup2(redup1);
-        fst::Concat(redup1, &redup2);
-        fst::Union(&mutable_input, redup2);
-        fst::RmEpsilon(&mutable_input);
+    const Rule &rule = grammar_.rules(i);
+    TouchFst(*FindRule(rule.main()));
+    if (rule.has_parens()) TouchFst(*FindRule(rule.parens()));
+    if (rule.has_assignments()) TouchFst(*FindRule(rule.assignments()));
+    if (rule.has_redup()) TouchFst(*FindRule(rule.redup()));
+  }
+  for (const auto &lookahead : lookaheads_) {
+    TouchFst(*lookahead.second);
+  }
+}
+
+bool RuleSystem::ApplyRule(int rule_index,
+                           MutableTransducer* input,
+                           bool use_lookahead,
+                           bool input_relabeled,
+                           bool best_path_only,
+                           std::unique_ptr<Transducer>* output) const {
+  const Rule& rule = grammar_.rules(rule_index);
+  if (rule.has_redup() && redup_filters_[rule_index].MayMatch(*input)) {
+    MutableTransducer redup;
+    // Not an error if it fails.
+    if (Rewrite(rule.redup(), *input, &redup) &&
+        redup.Start() != fst::kNoStateId) {
+      AddReduplication(redup, input);
+    }
+  }
+  const string& rule_name = rule.main();
+  if (pdt_rules_[rule_index] != nullptr) {
+    MutableTransducer* expanded = new MutableTransducer;
+    output->reset(expanded);
+    return ApplyPdtRule(*pdt_rules_[rule_index], *input, best_path_only,
+                        expanded);
+  }
+  if (UsesLookahead(rule_index, use_lookahead)) {
+    const LookaheadFst *lookahead_rule_fst = lookaheads_.at(rule_name).get();
+    if (!input_relabeled) relabel_tables_.at(rule_name)->Relabel(input);
+    output->reset(new fst::ComposeFst<StdArc>(*input, *lookahead_rule_fst));
+    return true;
+  }
+  // Otherwise we just use the regular rewrite mechanism
+  MutableTransducer* rewritten = new MutableTransducer;
+  output->reset(rewritten);
+  return Rewrite(rule_name, *input, rewritten);
+}
+
+namespace {
+
+// Adds the states of fst to output, and returns the state of output
+// that fst's start state became. Final states of fst stay final.
+StdArc::StateId AddStates(const MutableTransducer& fst,
+                          MutableTransducer* output) {
+  const StdArc::StateId offset = output->NumStates();
+  for (StdArc::StateId state = 0; state < fst.NumStates(); ++state) {
+    output->AddState();
+    output->SetFinal(offset + state, fst.Final(state));
+  }
+  for (StdArc::StateId state = 0; state < fst.NumStates(); ++state) {
+    for (fst::ArcIterator<MutableTransducer> aiter(fst, state);
+         !aiter.Done();
+         aiter.Next()) {
+      StdArc arc = aiter.Value();
+      arc.nextstate += offset;
+      output->AddArc(offset + state, arc);
+    }
+  }
+  return offset + fst.Start();
+}
+
+}  // namespace
+
+void RuleSystem::AddReduplication(const MutableTransducer& redup,
+                                  MutableTransducer* input) {
+  // The same as fst::Union(input, Concat(redup, redup)), without copying
+  // redup to concatenate it or removing epsilons afterwards, which the
+  // composition that follows handles anyway.
+  const StdArc::StateId first_offset = input->NumStates();
+  const StdArc::StateId first_start = AddStates(redup, input);
+  const StdArc::StateId second_start = AddStates(redup, input);
+  for (StdArc::StateId state = 0; state < redup.NumStates(); ++state) {
+    const StdArc::Weight final_weight = redup.Final(state);
+    if (final_weight == StdArc::Weight::Zero()) continue;
+    input->SetFinal(first_offset + state, StdArc::Weight::Zero());
+    input->AddArc(first_offset + state,
+                  StdArc(0, 0, final_weight, second_start));
+  }
+  const StdArc::StateId start = input->AddState();
+  input->AddArc(start, StdArc(0, 0, StdArc::Weight::One(), input->Start()));
+  input->AddArc(start, StdArc(0, 0, StdArc::Weight::One(), first_start));
+  input->SetStart(start);
+}
+
+bool RuleSystem::RedupFilter::MayMatch(const Transducer& input) const {
+  if (any_label) return true;
+  const StdArc::StateId start = input.Start();
+  if (start == fst::kNoStateId) return false;
+  if (input.Final(start) != StdArc::Weight::Zero()) return true;
+  for (fst::ArcIterator<Transducer> aiter(input, start);
+       !aiter.Done();
+       aiter.Next()) {
+    const StdArc::Label label = aiter.Value().olabel;
+    if (label == 0 ||
+        std::binary_search(first_labels.begin(), first_labels.end(), label)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RuleSystem::PrepareRedupFilters() {
+  redup_filters_.clear();
+  redup_filters_.resize(grammar_.rules_size());
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule &rule = grammar_.rules(i);
+    if (!rule.has_redup()) continue;
+    RedupFilter &filter = redup_filters_[i];
+    const Transducer &redup_fst = *FindRule(rule.redup());
+    const StdArc::StateId start = redup_fst.Start();
+    if (start == fst::kNoStateId) continue;
+    // A rule that can start with an epsilon or match the empty string can
+    // match anything as far as its first state tells.
+    filter.any_label = redup_fst.Final(start) != StdArc::Weight::Zero();
+    for (fst::ArcIterator<Transducer> aiter(redup_fst, start);
+         !aiter.Done();
+         aiter.Next()) {
+      if (aiter.Value().ilabel == 0) filter.any_label = true;
+      filter.first_labels.push_back(aiter.Value().ilabel);
+    }
+    std::sort(filter.first_labels.begin(), filter.first_labels.end());
+    filter.first_labels.erase(
+        std::unique(filter.first_labels.begin(), filter.first_labels.end()),
+        filter.first_labels.end());
+  }
+}
+
+bool RuleSystem::ApplyPdtRule(const PdtRule& pdt_rule,
+                              const Transducer& input,
+                              bool best_path_only,
+                              MutableTransducer* output) const {
+  MutableTransducer composed;
+  if (pdt_rule.assignments.empty()) {
+    fst::Compose(input, *pdt_rule.fst, pdt_rule.parens, &composed);
+    if (best_path_only) {
+      // The best balanced path can be found without expanding the PDT. The
+      // parens on it are then of no further use.
+      fst::ShortestPath(composed, pdt_rule.parens, output);
+      std::vector<std::pair<StdArc::Label, StdArc::Label>> relabel_pairs;
+      for (const auto &paren : pdt_rule.parens) {
+        relabel_pairs.push_back(std::make_pair(paren.first, 0));
+        relabel_pairs.push_back(std::make_pair(paren.second, 0));
       }
+      fst::Relabel(output, relabel_pairs, relabel_pairs);
+    } else {
+      fst::Expand(composed, pdt_rule.parens, output,
+                  true /* connect */, false /* keep_parentheses */);
+    }
+  } else {
+    // There is no MPDT shortest path, so MPDTs are always expanded.
+    fst::Compose(input, *pdt_rule.fst, pdt_rule.parens, pdt_rule.assignments,
+                 &composed);
+    fst::Expand(composed, pdt_rule.parens, pdt_rule.assignments, output,
+                true /* connect */, false /* keep_parentheses */);
+  }
+  return !output->Properties(fst::kError, false);
+}
+
+bool RuleSystem::PreparePdtRules() {
+  pdt_rules_.clear();
+  pdt_rules_.resize(grammar_.rules_size());
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule &rule = grammar_.rules(i);
+    if (!rule.has_parens()) continue;
+    std::unique_ptr<PdtRule> pdt_rule(new PdtRule);
+    const Transducer *rule_fst = FindRule(rule.main());
+    if (rule_fst->Properties(fst::kILabelSorted, true)) {
+      pdt_rule->fst = rule_fst;
+    } else {
+      pdt_rule->sorted_fst.reset(new MutableTransducer(*rule_fst));
+      fst::ArcSort(pdt_rule->sorted_fst.get(), fst::ILabelCompare<StdArc>());
+      pdt_rule->fst = pdt_rule->sorted_fst.get();
     }
-    const string& rule_name = rule.main();
-    string parens_rule = rule.has_parens() ? rule.parens() : "";
-    // Only use lookahead on non (M)PDT's
-    bool success = true;
-    if (parens_rule.empty()
-        && use_lookahead) {
-      std::map<string, LookaheadFst*>::iterator iter =
-          lookaheads_.find(rule_name);
-      LookaheadFst *lookahead_rule_fst;
-      if (iter == lookaheads_.end()) {
-        const Transducer *rule_fst = grm_->GetFst(rule_name);
-        lookahead_rule_fst = new LookaheadFst(*rule_fst);
-        lookaheads_[rule_name] = lookahead_rule_fst;
-      } else {
-        lookahead_rule_fst = iter->second;
+    // As GrmManager reads them: each arc of the parens transducer pairs an
+    // open paren with its close paren, and each arc of the assignments
+    // transducer assigns a paren to a stack.
+    const Transducer &parens_fst = *FindRule(rule.parens());
+    for (fst::StateIterator<Transducer> siter(parens_fst);
+         !siter.Done();
+         siter.Next()) {
+      for (fst::ArcIterator<Transducer> aiter(parens_fst, siter.Value());
+           !aiter.Done();
+           aiter.Next()) {
+        pdt_rule->parens.push_back(
+            std::make_pair(aiter.Value().ilabel, aiter.Value().olabel));
       }
-      LabelLookAheadRelabeler<StdArc>::Relabel(&mutable_input,
-                                               *lookahead_rule_fst,
-                                               false);
-      fst::ComposeFst<StdArc> tmp_output(mutable_input,
-                                             *lookahead_rule_fst);
-      *output = tmp_output;
-      if (output->NumStates() == 0) {
-        success = false;
+    }
+    if (rule.has_assignments()) {
+      const Transducer &assignments_fst = *FindRule(rule.assignments());
+      std::map<StdArc::Label, StdArc::Label> assignments;
+      for (fst::StateIterator<Transducer> siter(assignments_fst);
+           !siter.Done();
+           siter.Next()) {
+        for (fst::ArcIterator<Transducer> aiter(assignments_fst,
+                                                siter.Value());
+             !aiter.Done();
+             aiter.Next()) {
+          assignments[aiter.Value().ilabel] = aiter.Value().olabel;
+        }
+      }
+      for (const auto &paren : pdt_rule->parens) {
+        const auto it = assignments.find(paren.first);
+        if (it == assignments.end()) {
+          LoggerError("No assignment for paren %d in rule \"%s\"",
+                      paren.first, rule.assignments().c_str());
+          return false;
+        }
+        pdt_rule->assignments.push_back(it->second);
       }
-      // Otherwise we just use the regular rewrite mechanism
-    } else if (!grm_->Rewrite(rule_name,
-                              mutable_input,
-                              output,
-                              parens_rule
-                              )
-        || output->NumStates() == 0) {
-      success = false;
+    }
+    pdt_rules_[i] = std::move(pdt_rule);
+  }
+  return true;
+}
+
+namespace {
+
+// Whether fst, which is fully built, has no more than max_states states and
+// max_arcs arcs, where 0 means no limit.
+bool IsWithinLimits(const MutableTransducer& fst,
+                    int64 max_states,
+                    int64 max_arcs) {
+  if (max_states > 0 && fst.NumStates() > max_states) return false;
+  if (max_arcs > 0) {
+    int64 num_arcs = 0;
+    for (StdArc::StateId state = 0; state < fst.NumStates(); ++state) {
+      num_arcs += fst.NumArcs(state);
+      if (num_arcs > max_arcs) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool RuleSystem::ExpandRuleOutput(const Rule& rule,
+                                  std::unique_ptr<Transducer> rule_output,
+                                  MutableTransducer* output) const {
+  // Rewrite() and PDT rules give a VectorFst, and only lookahead compositions
+  // are delayed.
+  const MutableTransducer* expanded =
+      dynamic_cast<const MutableTransducer*>(rule_output.get());
+  bool within_limits;
+  if (expanded != nullptr) {
+    within_limits = IsWithinLimits(*expanded, grammar_.max_states(),
+                                   grammar_.max_arcs());
+    if (within_limits) {
+      *output = *expanded;
+      // So that output is the only user of its states, and is pruned in place.
+      rule_output.reset();
+    }
+  } else {
+    within_limits = CopyWithinLimits(*rule_output, grammar_.max_states(),
+                                     grammar_.max_arcs(), output);
+  }
+  if (!within_limits) {
+    LoggerError("Output of rule \"%s\" exceeds %lld states or %lld arcs",
+                rule.main().c_str(),
+                static_cast<long long>(grammar_.max_states()),
+                static_cast<long long>(grammar_.max_arcs()));
+    output->DeleteStates();
+    return false;
+  }
+  if (output->Start() == fst::kNoStateId) return false;
+  if (grammar_.prune_threshold() > 0) {
+    fst::Prune(output, StdArc::Weight(grammar_.prune_threshold()));
+  }
+  return true;
+}
+
+bool RuleSystem::ApplyRules(const Transducer& input,
+                            MutableTransducer* output,
+                            bool use_lookahead) const {
+  MutableTransducer mutable_input(input);
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule& rule = grammar_.rules(i);
+    std::unique_ptr<Transducer> rule_output;
+    bool success = ApplyRule(i, &mutable_input, use_lookahead,
+                             false /* input_relabeled */,
+                             false /* best_path_only */, &rule_output);
+    if (success) {
+      success = ExpandRuleOutput(rule, std::move(rule_output), output);
     }
     if (!success) {
-      LoggerError("Application of rule \"%s\" failed", rule_name.c_str());
+      LoggerError("Application of rule \"%s\" failed", rule.main().c_str());
       return false;
     }
     mutable_input = *output;
@@ -130,6 +744,83 @@ bool RuleSystem::ApplyRules(const Transducer& input,
   return true;
 }
 
+bool RuleSystem::ApplyRulesToBestPath(const Transducer& input,
+                                      bool use_lookahead,
+                                      LabelPath* path,
+                                      int64* num_states,
+                                      int64* num_arcs) const {
+  MutableTransducer mutable_input(input);
+  return FindBestPath(&mutable_input, false /* input_relabeled */,
+                      use_lookahead, path, num_states, num_arcs);
+}
+
+bool RuleSystem::ApplyRulesToBestPath(const string& input,
+                                      bool use_lookahead,
+                                      LabelPath* path,
+                                      int64* num_states,
+                                      int64* num_arcs) const {
+  // The labels the first rule's composition needs, if it relabels its input
+  // as it is. Reduplication needs the input's own labels.
+  const RelabelTable* relabel_table = nullptr;
+  if (grammar_.rules_size() > 0 && !grammar_.rules(0).has_redup() &&
+      UsesLookahead(0, use_lookahead)) {
+    relabel_table = relabel_tables_.at(grammar_.rules(0).main()).get();
+  }
+  // The same string transducer a byte StringCompiler would give, built in
+  // one pass.
+  MutableTransducer input_fst;
+  input_fst.ReserveStates(input.size() + 1);
+  StdArc::StateId state = input_fst.AddState();
+  input_fst.SetStart(state);
+  for (const char c : input) {
+    const StdArc::Label label = static_cast<unsigned char>(c);
+    const StdArc::StateId nextstate = input_fst.AddState();
+    input_fst.AddArc(state, StdArc(label,
+                                   relabel_table != nullptr
+                                       ? relabel_table->Relabel(label)
+                                       : label,
+                                   StdArc::Weight::One(),
+                                   nextstate));
+    state = nextstate;
+  }
+  input_fst.SetFinal(state, StdArc::Weight::One());
+  return FindBestPath(&input_fst, relabel_table != nullptr, use_lookahead,
+                      path, num_states, num_arcs);
+}
+
+bool RuleSystem::FindBestPath(MutableTransducer* input,
+                              bool input_relabeled,
+                              bool use_lookahead,
+                              LabelPath* path,
+                              int64* num_states,
+                              int64* num_arcs) const {
+  path->clear();
+  if (grammar_.rules_size() == 0) {
+    LoggerError("No rules in \"%s\"", grammar_name_.c_str());
+    return false;
+  }
+  for (int i = 0; i < grammar_.rules_size(); ++i) {
+    const Rule& rule = grammar_.rules(i);
+    std::unique_ptr<Transducer> rule_output;
+    const bool last_rule = i + 1 == grammar_.rules_size();
+    bool success = ApplyRule(i, input, use_lookahead, input_relabeled && i == 0,
+                             last_rule, &rule_output);
+    if (success && last_rule) {
+      // The output of the last rule is only ever searched for its best path,
+      // which can be done on the fly, and needs no pruning.
+      success = BestPath(*rule_output, grammar_.max_states(),
+                         grammar_.max_arcs(), path, num_states, num_arcs);
+    } else if (success) {
+      success = ExpandRuleOutput(rule, std::move(rule_output), input);
+    }
+    if (!success) {
+      LoggerError("Application of rule \"%s\" failed", rule.main().c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
 typedef fst::StringCompiler<StdArc> Compiler;
 typedef fst::StringPrinter<StdArc> Printer;
 
@@ -172,8 +863,31 @@ bool RuleSystem::ApplyRules(const Transducer& input,
   return true;
 }
 
+bool RuleSystem::Rewrite(const string& rule,
+                         const Transducer& input,
+                         MutableTransducer* output) const {
+  // The precomposed rule is not in the far.
+  if (grm_ != nullptr && rule != precomposed_name_) {
+    return grm_->Rewrite(rule, input, output, "");
+  }
+  // Mapped and precomposed rules are input-sorted.
+  const Transducer* rule_fst = FindRule(rule);
+  if (rule_fst == NULL) {
+    LoggerError("Rule \"%s\" not found in \"%s\"",
+                rule.c_str(), grammar_name_.c_str());
+    return false;
+  }
+  *output = fst::ComposeFst<StdArc>(input, *rule_fst);
+  return true;
+}
+
 const Transducer* RuleSystem::FindRule(const string& name) const {
-  return grm_->GetFst(name);
+  if (precomposed_ != nullptr && name == precomposed_name_) {
+    return precomposed_.get();
+  }
+  if (grm_ != nullptr) return grm_->GetFst(name);
+  const auto it = mapped_rules_.find(name);
+  return it == mapped_rules_.end() ? NULL : it->second.get();
 }
 
 
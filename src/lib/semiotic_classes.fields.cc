@@ -0,0 +1,2109 @@
+// Generated by protoc-gen-sparrowhawk from semiotic_classes.proto. DO NOT EDIT.
+
+#include <sparrowhawk/semiotic_classes.fields.h>
+
+#include <cstdio>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <sparrowhawk/semiotic_classes.pb.h>
+#include <sparrowhawk/logger.h>
+#include <sparrowhawk/message_fields.h>
+
+// Deprecated fields are still parsed and serialized.
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+namespace speech {
+namespace sparrowhawk {
+
+namespace {
+
+using ::speech::sparrowhawk::AppendFieldValue;
+using ::speech::sparrowhawk::FieldName;
+using ::speech::sparrowhawk::FindFieldIndex;
+using ::speech::sparrowhawk::MessageFields;
+using ::speech::sparrowhawk::ParseFieldValue;
+
+typedef google::protobuf::FieldDescriptor FieldDescriptor;
+typedef google::protobuf::Message Message;
+
+class CardinalFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 3},
+      {"field_order", 4},
+      {"integer", 0},
+      {"morphosyntactic_features", 1},
+      {"preserve_order", 2},
+    };
+    const int index =
+        FindFieldIndex(kNames, 5, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Cardinal::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Cardinal &m =
+        static_cast<const ::speech::sparrowhawk::Cardinal &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Cardinal::descriptor();
+    if (m.has_integer()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(4));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Cardinal &m =
+        static_cast<const ::speech::sparrowhawk::Cardinal &>(message);
+    switch (field->number()) {
+      case 5:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Cardinal &m =
+        static_cast<const ::speech::sparrowhawk::Cardinal &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.integer();
+      case 2:
+        return m.morphosyntactic_features();
+      case 4:
+        return m.code_switch();
+      case 5:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Cardinal &m =
+        static_cast<const ::speech::sparrowhawk::Cardinal &>(message);
+    switch (field->number()) {
+      case 3:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Cardinal *m = static_cast<::speech::sparrowhawk::Cardinal *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_integer(value);
+        return true;
+      case 2:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 3: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 4:
+        m->set_code_switch(value);
+        return true;
+      case 5:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class OrdinalFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 3},
+      {"field_order", 4},
+      {"integer", 0},
+      {"morphosyntactic_features", 1},
+      {"preserve_order", 2},
+    };
+    const int index =
+        FindFieldIndex(kNames, 5, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Ordinal::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Ordinal &m =
+        static_cast<const ::speech::sparrowhawk::Ordinal &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Ordinal::descriptor();
+    if (m.has_integer()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(4));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Ordinal &m =
+        static_cast<const ::speech::sparrowhawk::Ordinal &>(message);
+    switch (field->number()) {
+      case 5:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Ordinal &m =
+        static_cast<const ::speech::sparrowhawk::Ordinal &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.integer();
+      case 2:
+        return m.morphosyntactic_features();
+      case 4:
+        return m.code_switch();
+      case 5:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Ordinal &m =
+        static_cast<const ::speech::sparrowhawk::Ordinal &>(message);
+    switch (field->number()) {
+      case 3:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Ordinal *m = static_cast<::speech::sparrowhawk::Ordinal *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_integer(value);
+        return true;
+      case 2:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 3: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 4:
+        m->set_code_switch(value);
+        return true;
+      case 5:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class FractionFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 6},
+      {"denominator", 2},
+      {"field_order", 8},
+      {"integer_part", 0},
+      {"morphosyntactic_features", 4},
+      {"negative", 7},
+      {"numerator", 1},
+      {"preserve_order", 5},
+      {"style", 3},
+    };
+    const int index =
+        FindFieldIndex(kNames, 9, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Fraction::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Fraction &m =
+        static_cast<const ::speech::sparrowhawk::Fraction &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Fraction::descriptor();
+    if (m.has_integer_part()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_numerator()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_denominator()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.has_negative()) {
+      fields->push_back(descriptor->field(7));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(8));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Fraction &m =
+        static_cast<const ::speech::sparrowhawk::Fraction &>(message);
+    switch (field->number()) {
+      case 9:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Fraction &m =
+        static_cast<const ::speech::sparrowhawk::Fraction &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.integer_part();
+      case 2:
+        return m.numerator();
+      case 3:
+        return m.denominator();
+      case 5:
+        return m.morphosyntactic_features();
+      case 7:
+        return m.code_switch();
+      case 9:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Fraction &m =
+        static_cast<const ::speech::sparrowhawk::Fraction &>(message);
+    switch (field->number()) {
+      case 4:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 6:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      case 8:
+        AppendFieldValue(static_cast<bool>(m.negative()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Fraction *m = static_cast<::speech::sparrowhawk::Fraction *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_integer_part(value);
+        return true;
+      case 2:
+        m->set_numerator(value);
+        return true;
+      case 3:
+        m->set_denominator(value);
+        return true;
+      case 4: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 5:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 6: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 7:
+        m->set_code_switch(value);
+        return true;
+      case 8: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_negative(parsed);
+        }
+        return true;
+      }
+      case 9:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class TimeFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 9},
+      {"field_order", 10},
+      {"hours", 0},
+      {"minutes", 1},
+      {"morphosyntactic_features", 7},
+      {"preserve_order", 8},
+      {"seconds", 2},
+      {"speak_period", 3},
+      {"style", 5},
+      {"suffix", 4},
+      {"zone", 6},
+    };
+    const int index =
+        FindFieldIndex(kNames, 11, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Time::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Time &m =
+        static_cast<const ::speech::sparrowhawk::Time &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Time::descriptor();
+    if (m.has_hours()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_minutes()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_seconds()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_speak_period()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_suffix()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_zone()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(7));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(8));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(9));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(10));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Time &m =
+        static_cast<const ::speech::sparrowhawk::Time &>(message);
+    switch (field->number()) {
+      case 12:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Time &m =
+        static_cast<const ::speech::sparrowhawk::Time &>(message);
+    switch (field->number()) {
+      case 5:
+        return m.suffix();
+      case 7:
+        return m.zone();
+      case 9:
+        return m.morphosyntactic_features();
+      case 11:
+        return m.code_switch();
+      case 12:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Time &m =
+        static_cast<const ::speech::sparrowhawk::Time &>(message);
+    switch (field->number()) {
+      case 1:
+        AppendFieldValue(static_cast<int32>(m.hours()), text);
+        return true;
+      case 2:
+        AppendFieldValue(static_cast<int32>(m.minutes()), text);
+        return true;
+      case 3:
+        AppendFieldValue(static_cast<int32>(m.seconds()), text);
+        return true;
+      case 4:
+        AppendFieldValue(static_cast<bool>(m.speak_period()), text);
+        return true;
+      case 6:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 10:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Time *m = static_cast<::speech::sparrowhawk::Time *>(message);
+    switch (field->number()) {
+      case 1: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_hours(parsed);
+        }
+        return true;
+      }
+      case 2: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_minutes(parsed);
+        }
+        return true;
+      }
+      case 3: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_seconds(parsed);
+        }
+        return true;
+      }
+      case 4: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_speak_period(parsed);
+        }
+        return true;
+      }
+      case 5:
+        m->set_suffix(value);
+        return true;
+      case 6: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 7:
+        m->set_zone(value);
+        return true;
+      case 9:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 10: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 11:
+        m->set_code_switch(value);
+        return true;
+      case 12:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class DecimalFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 8},
+      {"exponent", 4},
+      {"field_order", 9},
+      {"fractional_part", 2},
+      {"integer_part", 1},
+      {"morphosyntactic_features", 6},
+      {"negative", 0},
+      {"preserve_order", 7},
+      {"quantity", 3},
+      {"style", 5},
+    };
+    const int index =
+        FindFieldIndex(kNames, 10, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Decimal::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Decimal &m =
+        static_cast<const ::speech::sparrowhawk::Decimal &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Decimal::descriptor();
+    if (m.has_negative()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_integer_part()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_fractional_part()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_quantity()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_exponent()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(7));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(8));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(9));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Decimal &m =
+        static_cast<const ::speech::sparrowhawk::Decimal &>(message);
+    switch (field->number()) {
+      case 10:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Decimal &m =
+        static_cast<const ::speech::sparrowhawk::Decimal &>(message);
+    switch (field->number()) {
+      case 2:
+        return m.integer_part();
+      case 3:
+        return m.fractional_part();
+      case 4:
+        return m.quantity();
+      case 5:
+        return m.exponent();
+      case 7:
+        return m.morphosyntactic_features();
+      case 9:
+        return m.code_switch();
+      case 10:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Decimal &m =
+        static_cast<const ::speech::sparrowhawk::Decimal &>(message);
+    switch (field->number()) {
+      case 1:
+        AppendFieldValue(static_cast<bool>(m.negative()), text);
+        return true;
+      case 6:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 8:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Decimal *m = static_cast<::speech::sparrowhawk::Decimal *>(message);
+    switch (field->number()) {
+      case 1: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_negative(parsed);
+        }
+        return true;
+      }
+      case 2:
+        m->set_integer_part(value);
+        return true;
+      case 3:
+        m->set_fractional_part(value);
+        return true;
+      case 4:
+        m->set_quantity(value);
+        return true;
+      case 5:
+        m->set_exponent(value);
+        return true;
+      case 6: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 7:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 8: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 9:
+        m->set_code_switch(value);
+        return true;
+      case 10:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class MeasureFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"cardinal", 2},
+      {"code_switch", 7},
+      {"decimal", 0},
+      {"field_order", 8},
+      {"fraction", 1},
+      {"morphosyntactic_features", 5},
+      {"preserve_order", 6},
+      {"style", 4},
+      {"units", 3},
+    };
+    const int index =
+        FindFieldIndex(kNames, 9, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Measure::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Measure &m =
+        static_cast<const ::speech::sparrowhawk::Measure &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Measure::descriptor();
+    if (m.has_decimal()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_fraction()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_cardinal()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_units()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(7));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(8));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Measure &m =
+        static_cast<const ::speech::sparrowhawk::Measure &>(message);
+    switch (field->number()) {
+      case 9:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    const ::speech::sparrowhawk::Measure &m =
+        static_cast<const ::speech::sparrowhawk::Measure &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.decimal();
+      case 2:
+        return m.fraction();
+      case 3:
+        return m.cardinal();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedMessage(message, field,
+                                                        index) :
+            message.GetReflection()->GetMessage(message, field);
+    }
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Measure &m =
+        static_cast<const ::speech::sparrowhawk::Measure &>(message);
+    switch (field->number()) {
+      case 4:
+        return m.units();
+      case 6:
+        return m.morphosyntactic_features();
+      case 8:
+        return m.code_switch();
+      case 9:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Measure &m =
+        static_cast<const ::speech::sparrowhawk::Measure &>(message);
+    switch (field->number()) {
+      case 5:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 7:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    ::speech::sparrowhawk::Measure *m = static_cast<::speech::sparrowhawk::Measure *>(message);
+    switch (field->number()) {
+      case 1:
+        return m->mutable_decimal();
+      case 2:
+        return m->mutable_fraction();
+      case 3:
+        return m->mutable_cardinal();
+      default:
+        return field->is_repeated() ?
+            message->GetReflection()->AddMessage(message, field) :
+            message->GetReflection()->MutableMessage(message, field);
+    }
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Measure *m = static_cast<::speech::sparrowhawk::Measure *>(message);
+    switch (field->number()) {
+      case 4:
+        m->set_units(value);
+        return true;
+      case 5: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 6:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 7: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 8:
+        m->set_code_switch(value);
+        return true;
+      case 9:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class DateFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 10},
+      {"day", 1},
+      {"era", 7},
+      {"field_order", 11},
+      {"month", 2},
+      {"morphosyntactic_features", 8},
+      {"preserve_order", 9},
+      {"short_year", 6},
+      {"style", 4},
+      {"text", 5},
+      {"weekday", 0},
+      {"year", 3},
+    };
+    const int index =
+        FindFieldIndex(kNames, 12, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Date::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Date &m =
+        static_cast<const ::speech::sparrowhawk::Date &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Date::descriptor();
+    if (m.has_weekday()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_day()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_month()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_year()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_text()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_short_year()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.has_era()) {
+      fields->push_back(descriptor->field(7));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(8));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(9));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(10));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(11));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Date &m =
+        static_cast<const ::speech::sparrowhawk::Date &>(message);
+    switch (field->number()) {
+      case 12:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Date &m =
+        static_cast<const ::speech::sparrowhawk::Date &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.weekday();
+      case 2:
+        return m.day();
+      case 3:
+        return m.month();
+      case 4:
+        return m.year();
+      case 6:
+        return m.text();
+      case 8:
+        return m.era();
+      case 9:
+        return m.morphosyntactic_features();
+      case 11:
+        return m.code_switch();
+      case 12:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Date &m =
+        static_cast<const ::speech::sparrowhawk::Date &>(message);
+    switch (field->number()) {
+      case 5:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 7:
+        AppendFieldValue(static_cast<bool>(m.short_year()), text);
+        return true;
+      case 10:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Date *m = static_cast<::speech::sparrowhawk::Date *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_weekday(value);
+        return true;
+      case 2:
+        m->set_day(value);
+        return true;
+      case 3:
+        m->set_month(value);
+        return true;
+      case 4:
+        m->set_year(value);
+        return true;
+      case 5: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 6:
+        m->set_text(value);
+        return true;
+      case 7: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_short_year(parsed);
+        }
+        return true;
+      }
+      case 8:
+        m->set_era(value);
+        return true;
+      case 9:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 10: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 11:
+        m->set_code_switch(value);
+        return true;
+      case 12:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class MoneyFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"amount", 0},
+      {"code_switch", 6},
+      {"currency", 2},
+      {"field_order", 7},
+      {"morphosyntactic_features", 4},
+      {"preserve_order", 5},
+      {"quantity", 1},
+      {"style", 3},
+    };
+    const int index =
+        FindFieldIndex(kNames, 8, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Money::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Money &m =
+        static_cast<const ::speech::sparrowhawk::Money &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Money::descriptor();
+    if (m.has_amount()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_quantity()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_currency()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(7));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Money &m =
+        static_cast<const ::speech::sparrowhawk::Money &>(message);
+    switch (field->number()) {
+      case 8:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    const ::speech::sparrowhawk::Money &m =
+        static_cast<const ::speech::sparrowhawk::Money &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.amount();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedMessage(message, field,
+                                                        index) :
+            message.GetReflection()->GetMessage(message, field);
+    }
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Money &m =
+        static_cast<const ::speech::sparrowhawk::Money &>(message);
+    switch (field->number()) {
+      case 3:
+        return m.currency();
+      case 5:
+        return m.morphosyntactic_features();
+      case 7:
+        return m.code_switch();
+      case 8:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Money &m =
+        static_cast<const ::speech::sparrowhawk::Money &>(message);
+    switch (field->number()) {
+      case 2:
+        AppendFieldValue(static_cast<int64>(m.quantity()), text);
+        return true;
+      case 4:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 6:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    ::speech::sparrowhawk::Money *m = static_cast<::speech::sparrowhawk::Money *>(message);
+    switch (field->number()) {
+      case 1:
+        return m->mutable_amount();
+      default:
+        return field->is_repeated() ?
+            message->GetReflection()->AddMessage(message, field) :
+            message->GetReflection()->MutableMessage(message, field);
+    }
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Money *m = static_cast<::speech::sparrowhawk::Money *>(message);
+    switch (field->number()) {
+      case 2: {
+        int64 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_quantity(parsed);
+        }
+        return true;
+      }
+      case 3:
+        m->set_currency(value);
+        return true;
+      case 4: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 5:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 6: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 7:
+        m->set_code_switch(value);
+        return true;
+      case 8:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class TelephoneFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 6},
+      {"country_code", 0},
+      {"extension", 2},
+      {"field_order", 7},
+      {"morphosyntactic_features", 4},
+      {"number_part", 1},
+      {"preserve_order", 5},
+      {"style", 3},
+    };
+    const int index =
+        FindFieldIndex(kNames, 8, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Telephone::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Telephone &m =
+        static_cast<const ::speech::sparrowhawk::Telephone &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Telephone::descriptor();
+    if (m.has_country_code()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.number_part_size() > 0) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_extension()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_style()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(7));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Telephone &m =
+        static_cast<const ::speech::sparrowhawk::Telephone &>(message);
+    switch (field->number()) {
+      case 2:
+        return m.number_part_size();
+      case 8:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Telephone &m =
+        static_cast<const ::speech::sparrowhawk::Telephone &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.country_code();
+      case 2:
+        return m.number_part(index);
+      case 3:
+        return m.extension();
+      case 5:
+        return m.morphosyntactic_features();
+      case 7:
+        return m.code_switch();
+      case 8:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Telephone &m =
+        static_cast<const ::speech::sparrowhawk::Telephone &>(message);
+    switch (field->number()) {
+      case 4:
+        AppendFieldValue(static_cast<int32>(m.style()), text);
+        return true;
+      case 6:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Telephone *m = static_cast<::speech::sparrowhawk::Telephone *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_country_code(value);
+        return true;
+      case 2:
+        m->add_number_part(value);
+        return true;
+      case 3:
+        m->set_extension(value);
+        return true;
+      case 4: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_style(parsed);
+        }
+        return true;
+      }
+      case 5:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 6: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 7:
+        m->set_code_switch(value);
+        return true;
+      case 8:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class ElectronicFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 10},
+      {"domain", 3},
+      {"field_order", 11},
+      {"fragment_id", 7},
+      {"morphosyntactic_features", 8},
+      {"password", 2},
+      {"path", 5},
+      {"port", 4},
+      {"preserve_order", 9},
+      {"protocol", 0},
+      {"query_string", 6},
+      {"username", 1},
+    };
+    const int index =
+        FindFieldIndex(kNames, 12, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Electronic::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Electronic &m =
+        static_cast<const ::speech::sparrowhawk::Electronic &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Electronic::descriptor();
+    if (m.has_protocol()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_username()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_password()) {
+      fields->push_back(descriptor->field(2));
+    }
+    if (m.has_domain()) {
+      fields->push_back(descriptor->field(3));
+    }
+    if (m.has_port()) {
+      fields->push_back(descriptor->field(4));
+    }
+    if (m.has_path()) {
+      fields->push_back(descriptor->field(5));
+    }
+    if (m.has_query_string()) {
+      fields->push_back(descriptor->field(6));
+    }
+    if (m.has_fragment_id()) {
+      fields->push_back(descriptor->field(7));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(8));
+    }
+    if (m.has_preserve_order()) {
+      fields->push_back(descriptor->field(9));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(10));
+    }
+    if (m.field_order_size() > 0) {
+      fields->push_back(descriptor->field(11));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    const ::speech::sparrowhawk::Electronic &m =
+        static_cast<const ::speech::sparrowhawk::Electronic &>(message);
+    switch (field->number()) {
+      case 12:
+        return m.field_order_size();
+      default:
+        return message.GetReflection()->FieldSize(message, field);
+    }
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Electronic &m =
+        static_cast<const ::speech::sparrowhawk::Electronic &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.protocol();
+      case 2:
+        return m.username();
+      case 3:
+        return m.password();
+      case 4:
+        return m.domain();
+      case 6:
+        return m.path();
+      case 7:
+        return m.query_string();
+      case 8:
+        return m.fragment_id();
+      case 9:
+        return m.morphosyntactic_features();
+      case 11:
+        return m.code_switch();
+      case 12:
+        return m.field_order(index);
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    const ::speech::sparrowhawk::Electronic &m =
+        static_cast<const ::speech::sparrowhawk::Electronic &>(message);
+    switch (field->number()) {
+      case 5:
+        AppendFieldValue(static_cast<int32>(m.port()), text);
+        return true;
+      case 10:
+        AppendFieldValue(static_cast<bool>(m.preserve_order()), text);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Electronic *m = static_cast<::speech::sparrowhawk::Electronic *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_protocol(value);
+        return true;
+      case 2:
+        m->set_username(value);
+        return true;
+      case 3:
+        m->set_password(value);
+        return true;
+      case 4:
+        m->set_domain(value);
+        return true;
+      case 5: {
+        int32 parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_port(parsed);
+        }
+        return true;
+      }
+      case 6:
+        m->set_path(value);
+        return true;
+      case 7:
+        m->set_query_string(value);
+        return true;
+      case 8:
+        m->set_fragment_id(value);
+        return true;
+      case 9:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 10: {
+        bool parsed;
+        if (ParseFieldValue(value, &parsed)) {
+          m->set_preserve_order(parsed);
+        }
+        return true;
+      }
+      case 11:
+        m->set_code_switch(value);
+        return true;
+      case 12:
+        m->add_field_order(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class ConnectorFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 2},
+      {"morphosyntactic_features", 1},
+      {"type", 0},
+    };
+    const int index =
+        FindFieldIndex(kNames, 3, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Connector::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Connector &m =
+        static_cast<const ::speech::sparrowhawk::Connector &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Connector::descriptor();
+    if (m.has_type()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(2));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    return message.GetReflection()->FieldSize(message, field);
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Connector &m =
+        static_cast<const ::speech::sparrowhawk::Connector &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.type();
+      case 2:
+        return m.morphosyntactic_features();
+      case 3:
+        return m.code_switch();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    return false;
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Connector *m = static_cast<::speech::sparrowhawk::Connector *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_type(value);
+        return true;
+      case 2:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 3:
+        m->set_code_switch(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+class AbbreviationFields : public MessageFields {
+ public:
+  const FieldDescriptor *FindFieldByName(
+      const string &name) const override {
+    static const FieldName kNames[] = {
+      {"code_switch", 2},
+      {"morphosyntactic_features", 1},
+      {"text", 0},
+    };
+    const int index =
+        FindFieldIndex(kNames, 3, name);
+    return index < 0 ? NULL : ::speech::sparrowhawk::Abbreviation::descriptor()->field(index);
+  }
+
+  void ListFields(
+      const Message &message,
+      std::vector<const FieldDescriptor *> *fields) const override {
+    const ::speech::sparrowhawk::Abbreviation &m =
+        static_cast<const ::speech::sparrowhawk::Abbreviation &>(message);
+    const google::protobuf::Descriptor *descriptor = ::speech::sparrowhawk::Abbreviation::descriptor();
+    if (m.has_text()) {
+      fields->push_back(descriptor->field(0));
+    }
+    if (m.has_morphosyntactic_features()) {
+      fields->push_back(descriptor->field(1));
+    }
+    if (m.has_code_switch()) {
+      fields->push_back(descriptor->field(2));
+    }
+  }
+
+  int FieldSize(const Message &message,
+                const FieldDescriptor *field) const override {
+    return message.GetReflection()->FieldSize(message, field);
+  }
+
+  const Message &GetMessage(const Message &message,
+                            const FieldDescriptor *field,
+                            int index) const override {
+    return field->is_repeated() ?
+        message.GetReflection()->GetRepeatedMessage(message, field,
+                                                    index) :
+        message.GetReflection()->GetMessage(message, field);
+  }
+
+  const string &GetString(const Message &message,
+                          const FieldDescriptor *field,
+                          int index,
+                          string *scratch) const override {
+    const ::speech::sparrowhawk::Abbreviation &m =
+        static_cast<const ::speech::sparrowhawk::Abbreviation &>(message);
+    switch (field->number()) {
+      case 1:
+        return m.text();
+      case 2:
+        return m.morphosyntactic_features();
+      case 3:
+        return m.code_switch();
+      default:
+        return field->is_repeated() ?
+            message.GetReflection()->GetRepeatedStringReference(
+                message, field, index, scratch) :
+            message.GetReflection()->GetStringReference(
+                message, field, scratch);
+    }
+  }
+
+  bool AppendValue(const Message &message,
+                   const FieldDescriptor *field,
+                   int index,
+                   string *text) const override {
+    return false;
+  }
+
+  Message *MutableMessage(
+      Message *message,
+      const FieldDescriptor *field) const override {
+    return field->is_repeated() ?
+        message->GetReflection()->AddMessage(message, field) :
+        message->GetReflection()->MutableMessage(message, field);
+  }
+
+  bool SetFieldFromString(Message *message,
+                          const FieldDescriptor *field,
+                          const string &value) const override {
+    ::speech::sparrowhawk::Abbreviation *m = static_cast<::speech::sparrowhawk::Abbreviation *>(message);
+    switch (field->number()) {
+      case 1:
+        m->set_text(value);
+        return true;
+      case 2:
+        m->set_morphosyntactic_features(value);
+        return true;
+      case 3:
+        m->set_code_switch(value);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+};
+
+}  // namespace
+
+void RegisterSemioticClassesMessageFields() {
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Cardinal::descriptor(),
+      new CardinalFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Ordinal::descriptor(),
+      new OrdinalFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Fraction::descriptor(),
+      new FractionFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Time::descriptor(),
+      new TimeFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Decimal::descriptor(),
+      new DecimalFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Measure::descriptor(),
+      new MeasureFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Date::descriptor(),
+      new DateFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Money::descriptor(),
+      new MoneyFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Telephone::descriptor(),
+      new TelephoneFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Electronic::descriptor(),
+      new ElectronicFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Connector::descriptor(),
+      new ConnectorFields);
+  ::speech::sparrowhawk::RegisterMessageFields(
+      ::speech::sparrowhawk::Abbreviation::descriptor(),
+      new AbbreviationFields);
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
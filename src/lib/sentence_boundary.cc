@@ -55,6 +55,22 @@ bool SentenceBoundary::LoadSentenceBoundaryExceptions(const string &filename) {
 
 std::vector<string> SentenceBoundary::ExtractSentences(
     const string &input_text) const {
+  const std::vector<int> cutpoints = FindCutpoints(input_text);
+  std::vector<string> result;
+  int last = 0;
+  string sentence;
+  for (int i = 0; i < cutpoints.size(); ++i) {
+    sentence = StripWhitespace(input_text.substr(last, cutpoints[i] - last));
+    if (!sentence.empty()) result.push_back(sentence);
+    last = cutpoints[i];
+  }
+  sentence = StripWhitespace(input_text.substr(last));
+  if (!sentence.empty()) result.push_back(sentence);
+  return result;
+}
+
+std::vector<int> SentenceBoundary::FindCutpoints(
+    const string &input_text) const {
   std::vector<RegMatch> potentials;
   regexp_->GetAllMatches(input_text, &potentials);
   std::vector<int> cutpoints;
@@ -70,17 +86,7 @@ std::vector<string> SentenceBoundary::ExtractSentences(
       last = end;
     }
   }
-  std::vector<string> result;
-  last = 0;
-  string sentence;
-  for (int i = 0; i < cutpoints.size(); ++i) {
-    sentence = StripWhitespace(input_text.substr(last, cutpoints[i] - last));
-    if (!sentence.empty()) result.push_back(sentence);
-    last = cutpoints[i];
-  }
-  sentence = StripWhitespace(input_text.substr(last));
-  if (!sentence.empty()) result.push_back(sentence);
-  return result;
+  return cutpoints;
 }
 
 bool SentenceBoundary::EvaluateCandidate(const string &input_text,
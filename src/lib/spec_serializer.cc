@@ -19,7 +19,9 @@ using std::vector;
 
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
+#include <sparrowhawk/field_trie.h>
 #include <sparrowhawk/items.pb.h>
+#include <sparrowhawk/message_fields.h>
 #include <sparrowhawk/serialization_spec.pb.h>
 #include <sparrowhawk/style_serializer.h>
 
@@ -35,12 +37,16 @@ namespace {
 typedef Serializer::MutableTransducer MutableTransducer;
 const char kClassSeparator[] = "|";
 
+// The cost each style starts with.
+const float kStyleCost = 1;
+
 }  // namespace
 
 std::unique_ptr<Serializer> Serializer::Create(
     const SerializeSpec &serialize_spec) {
   std::unique_ptr<Serializer> serializer(new Serializer());
   const Descriptor *token_descriptor = Token::descriptor();
+  serializer->token_fields_ = FindMessageFields(token_descriptor);
   for (const ClassSpec &class_spec : serialize_spec.class_spec()) {
     const FieldDescriptor *class_descriptor =
       token_descriptor->FindFieldByName(class_spec.semiotic_class());
@@ -49,12 +55,22 @@ std::unique_ptr<Serializer> Serializer::Create(
                  << " field in Token proto";
       return nullptr;
     }
-    std::vector<std::unique_ptr<StyleSerializer>> &styles =
-        serializer->serializers_[class_descriptor];
+    std::vector<std::unique_ptr<ClassSerializer>> &serializers =
+        serializer->serializers_;
+    const int number = class_descriptor->number();
+    if (number >= serializers.size()) serializers.resize(number + 1);
+    if (serializers[number] == nullptr) {
+      serializers[number].reset(new ClassSerializer);
+      serializers[number]->label = class_descriptor->name() + kClassSeparator;
+    }
+    // Specs for the same class add to its styles.
+    ClassSerializer *class_serializer = serializers[number].get();
     for (const StyleSpec &style_spec : class_spec.style_spec()) {
-      auto style_serializer = StyleSerializer::Create(style_spec);
+      auto style_serializer =
+          StyleSerializer::Create(style_spec, &serializer->field_trie_,
+                                  &class_serializer->presence);
       if (style_serializer) {
-        styles.push_back(std::move(style_serializer));
+        class_serializer->styles.push_back(std::move(style_serializer));
       } else {
         return nullptr;
       }
@@ -65,24 +81,66 @@ std::unique_ptr<Serializer> Serializer::Create(
 
 MutableTransducer Serializer::Serialize(const Token &token) const {
   MutableTransducer fst;
-  const Reflection *reflection = token.GetReflection();
-  for (const auto &candidate_class : serializers_) {
-    if (reflection->HasField(token, candidate_class.first)) {
-      string_compiler_(candidate_class.first->name() + kClassSeparator,
-                       &fst);
-      MutableTransducer fst_styles;
-      for (const auto &candidate_style : candidate_class.second) {
-        MutableTransducer fst_style;
-        fst_style.SetStart(fst_style.AddState());
-        fst_style.SetFinal(0, 1);
-        if (candidate_style->Serialize(token, &fst_style)) {
-          Union(&fst_styles, fst_style);
+  Serialize(token, &fst);
+  return fst;
+}
+
+void Serializer::Serialize(const Token &token, MutableTransducer *fst) const {
+  fst->DeleteStates();
+  // Only the fields set in the token are looked up, however many classes the
+  // spec has.
+  std::vector<const FieldDescriptor *> fields;
+  FieldPresence::Bits presence;
+  // Messages shared by several field paths are looked up once.
+  FieldTrie::Messages messages(field_trie_, token);
+  if (token_fields_ != nullptr) {
+    token_fields_->ListFields(token, &fields);
+  } else {
+    token.GetReflection()->ListFields(token, &fields);
+  }
+  for (const FieldDescriptor *field : fields) {
+    const int number = field->number();
+    if (number < serializers_.size() && serializers_[number] != nullptr) {
+      const ClassSerializer &candidate_class = *serializers_[number];
+      // Each class set in the token replaces the serialization of the one
+      // before.
+      fst->DeleteStates();
+      fst->SetStart(fst->AddState());
+      fst->SetFinal(fst->Start(), Weight::One());
+      RecordSerializer::AppendString(candidate_class.label, fst);
+      // The fields the styles check are looked up once for all of them.
+      candidate_class.presence.Compute(&messages, &presence);
+      // Each style is built after the states so far, and branched to from the
+      // end of the label once the token serializes with it. Otherwise its
+      // states are removed again.
+      const StateId branch_state = fst->NumStates() - 1;
+      fst->SetFinal(branch_state, Weight::Zero());
+      for (const auto &candidate_style : candidate_class.styles) {
+        const StateId style_start = fst->AddState();
+        fst->SetFinal(style_start, kStyleCost);
+        if (candidate_style->Serialize(token, presence, &messages, fst)) {
+          fst->AddArc(branch_state, Arc(0, 0, Weight::One(), style_start));
+        } else {
+          std::vector<StateId> style_states;
+          for (StateId state = style_start; state < fst->NumStates(); ++state) {
+            style_states.push_back(state);
+          }
+          fst->DeleteStates(style_states);
         }
       }
-      Concat(&fst, fst_styles);
+      // The verbalizer is given an epsilon-free acceptor, and where several
+      // styles apply, a deterministic and minimal one, so that their shared
+      // prefixes are only composed with the verbalizer rules once.
+      const int num_styles = fst->NumArcs(branch_state);
+      if (num_styles > 0) fst::RmEpsilon(fst);
+      if (num_styles > 1) {
+        MutableTransducer determinized;
+        fst::Determinize(*fst, &determinized);
+        fst::Minimize(&determinized);
+        *fst = determinized;
+      }
     }
   }
-  return fst;
 }
 
 }  // namespace sparrowhawk
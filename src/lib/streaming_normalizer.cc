@@ -0,0 +1,82 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/streaming_normalizer.h>
+
+#include <memory>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <sparrowhawk/sentence_boundary.h>
+#include <sparrowhawk/string_utils.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+StreamingNormalizer::StreamingNormalizer(
+    std::shared_ptr<const NormalizerModel> model, Callback callback)
+    : model_(model),
+      callback_(callback),
+      session_(model),
+      max_buffer_size_(kDefaultMaxBufferSize) { }
+
+StreamingNormalizer::~StreamingNormalizer() { }
+
+void StreamingNormalizer::Feed(const string &text) {
+  buffer_ += text;
+  const std::vector<int> cutpoints =
+      model_->sentence_boundary().FindCutpoints(buffer_);
+  int last = 0;
+  for (int i = 0; i < cutpoints.size(); ++i) {
+    // A boundary that reaches the end of the input so far might still grow
+    // with the text that follows, so it is not yet certain.
+    if (cutpoints[i] >= buffer_.size()) break;
+    Emit(buffer_.substr(last, cutpoints[i] - last));
+    last = cutpoints[i];
+  }
+  buffer_.erase(0, last);
+  if (buffer_.size() > max_buffer_size_) {
+    // Cuts at the last space or, failing that, before any incomplete UTF-8
+    // character at the end.
+    size_t cut = buffer_.rfind(' ');
+    if (cut == string::npos || cut == 0) {
+      size_t start = buffer_.size() - 1;
+      while (start > 0 && (buffer_[start] & 0xC0) == 0x80) --start;
+      const unsigned char lead = buffer_[start];
+      const size_t length =
+          lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+      cut = start + length > buffer_.size() ? start : buffer_.size();
+    }
+    Emit(buffer_.substr(0, cut));
+    buffer_.erase(0, cut);
+  }
+}
+
+void StreamingNormalizer::Flush() {
+  for (const auto &sentence : model_->SentenceSplitter(buffer_)) {
+    Emit(sentence);
+  }
+  buffer_.clear();
+}
+
+void StreamingNormalizer::Emit(const string &sentence) {
+  const string stripped = StripWhitespace(sentence);
+  if (stripped.empty()) return;
+  if (!session_.Normalize(stripped, &output_)) output_.clear();
+  callback_(output_);
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
@@ -13,6 +13,7 @@
 // Copyright 2015 and onwards Google, Inc.
 #include <sparrowhawk/style_serializer.h>
 
+#include <map>
 #include <memory>
 #include <string>
 using std::string;
@@ -24,7 +25,7 @@ using std::vector;
 #include <google/protobuf/text_format.h>
 #include <sparrowhawk/items.pb.h>
 #include <sparrowhawk/serialization_spec.pb.h>
-#include <sparrowhawk/field_path.h>
+#include <sparrowhawk/field_trie.h>
 #include <sparrowhawk/record_serializer.h>
 #include <sparrowhawk/string_utils.h>
 
@@ -39,9 +40,10 @@ using google::protobuf::Message;
 
 bool StyleSerializer::CreateRecordSerializers(
     const StyleSpec &style_spec,
+    FieldTrie *trie,
     const std::unique_ptr<StyleSerializer> &style_serializer) {
   for (const RecordSpec &record_spec : style_spec.record_spec()) {
-    auto record_serializer = RecordSerializer::Create(record_spec);
+    auto record_serializer = RecordSerializer::Create(record_spec, trie);
     if (record_serializer) {
       style_serializer->record_serializers_.push_back(
           std::move(record_serializer));
@@ -52,111 +54,122 @@ bool StyleSerializer::CreateRecordSerializers(
   return true;
 }
 
-bool StyleSerializer::SetRequiredFieldPaths(
+int FieldPresence::AddPath(const string &path_string, FieldTrie *trie) {
+  auto it = bits_.find(path_string);
+  if (it != bits_.end()) return it->second;
+  FieldTrie::Field field;
+  if (!trie->AddPath(path_string, &field)) return -1;
+  const int bit = paths_.size();
+  paths_.push_back(field);
+  bits_[path_string] = bit;
+  return bit;
+}
+
+void FieldPresence::Compute(FieldTrie::Messages *messages,
+                            Bits *presence) const {
+  presence->assign((paths_.size() + 63) / 64, 0);
+  for (int bit = 0; bit < paths_.size(); ++bit) {
+    if (messages->IsSet(paths_[bit])) {
+      (*presence)[bit / 64] |= uint64{1} << (bit % 64);
+    }
+  }
+}
+
+void StyleSerializer::SetBit(int bit, FieldPresence::Bits *mask) {
+  if (bit / 64 >= mask->size()) mask->resize(bit / 64 + 1, 0);
+  (*mask)[bit / 64] |= uint64{1} << (bit % 64);
+}
+
+bool StyleSerializer::SetRequiredFieldMasks(
     const StyleSpec &style_spec,
+    FieldTrie *trie,
+    FieldPresence *presence,
     const std::unique_ptr<StyleSerializer> &style_serializer) {
-  const Descriptor *token_descriptor = Token::descriptor();
   for (const string &required_fields : style_spec.required_fields()) {
-    std::vector<FieldPath> any_of;
+    FieldPresence::Bits any_of;
+    int num_alternatives = 0;
     for (const auto &required_field :
          SplitString(required_fields, "|")) {
-      std::unique_ptr<FieldPath> field_path =
-          FieldPath::Create(token_descriptor);
-      any_of.push_back(*field_path);
-      if (!any_of.back().Parse(required_field)) {
+      const int bit = presence->AddPath(required_field, trie);
+      if (bit < 0) {
         LOG(ERROR) << "FieldPath failed to parse for required field: "
                    << required_field;
         return false;
       }
+      SetBit(bit, &any_of);
+      ++num_alternatives;
+    }
+    if (num_alternatives == 1) {
+      // Folded into one mask with the other fields that have no
+      // alternatives.
+      for (int i = 0; i < any_of.size(); ++i) {
+        if (any_of[i] == 0) continue;
+        if (i >= style_serializer->required_all_.size()) {
+          style_serializer->required_all_.resize(i + 1, 0);
+        }
+        style_serializer->required_all_[i] |= any_of[i];
+      }
+    } else {
+      style_serializer->required_any_.push_back(std::move(any_of));
     }
-    style_serializer->required_fields_.push_back(std::move(any_of));
   }
   return true;
 }
 
-bool StyleSerializer::SetProhibitedFieldPaths(
+bool StyleSerializer::SetProhibitedFieldMask(
     const StyleSpec &style_spec,
+    FieldTrie *trie,
+    FieldPresence *presence,
     const std::unique_ptr<StyleSerializer> &style_serializer) {
-  const Descriptor *token_descriptor = Token::descriptor();
   for (const string &prohibited_field : style_spec.prohibited_fields()) {
-    std::vector<FieldPath> &prohibited_fields =
-        style_serializer->prohibited_fields_;
-    std::unique_ptr<FieldPath> field_path =
-        FieldPath::Create(token_descriptor);
-    prohibited_fields.push_back(*field_path);
-    if (!prohibited_fields.back().Parse(prohibited_field)) {
+    const int bit = presence->AddPath(prohibited_field, trie);
+    if (bit < 0) {
       LOG(ERROR) << "FieldPath failed to parse for prohibited field: "
                  << prohibited_field;
       return false;
     }
+    SetBit(bit, &style_serializer->prohibited_);
   }
   return true;
 }
 
 std::unique_ptr<StyleSerializer> StyleSerializer::Create(
-    const StyleSpec &style_spec) {
+    const StyleSpec &style_spec, FieldTrie *trie, FieldPresence *presence) {
   std::unique_ptr<StyleSerializer> style_serializer(new StyleSerializer());
-  if (!CreateRecordSerializers(style_spec, style_serializer) ||
-      !SetRequiredFieldPaths(style_spec, style_serializer) ||
-      !SetProhibitedFieldPaths(style_spec, style_serializer)) {
+  if (!CreateRecordSerializers(style_spec, trie, style_serializer) ||
+      !SetRequiredFieldMasks(style_spec, trie, presence, style_serializer) ||
+      !SetProhibitedFieldMask(style_spec, trie, presence, style_serializer)) {
     return nullptr;
   }
   return style_serializer;
 }
 
-bool StyleSerializer::IsFieldSet(const Message &root,
-                                 const FieldPath &field_path) const {
-  const Message *parent;
-  const FieldDescriptor *field;
-  if (!field_path.Follow(root, &parent, &field)) {
-    LOG(ERROR) << "FieldPath traversal failed for input Message "
-               << root.DebugString();
-    return false;
+bool StyleSerializer::CheckFields(const FieldPresence::Bits &presence) const {
+  // The masks never have more words than presence, as the paths they refer
+  // to were all added before it was computed.
+  for (int i = 0; i < required_all_.size(); ++i) {
+    if ((presence[i] & required_all_[i]) != required_all_[i]) return false;
   }
-  const Reflection *parent_reflection = parent->GetReflection();
-  if (field->label() == FieldDescriptor::LABEL_REPEATED) {
-    // The field is assumed to be a scalar here.
-    if (parent_reflection->FieldSize(*parent, field) == 0) {
-      return false;
-    }
-  } else if (!parent_reflection->HasField(*parent, field)) {
-    return false;
+  for (int i = 0; i < prohibited_.size(); ++i) {
+    if ((presence[i] & prohibited_[i]) != 0) return false;
   }
-  return true;
-}
-
-bool StyleSerializer::CheckRequiredFields(const Token &token) const {
-  for (const std::vector<FieldPath> &field_paths : required_fields_) {
+  for (const FieldPresence::Bits &any_of : required_any_) {
     bool found = false;
-    for (const FieldPath &field_path : field_paths) {
-      if (IsFieldSet(token, field_path)) {
-        found = true;
-        break;
-      }
-    }
-    if (!found) {
-      return false;
-    }
-  }
-  return true;
-}
-
-bool StyleSerializer::CheckProhibitedFields(const Token &token) const {
-  for (const FieldPath &field_path : prohibited_fields_) {
-    if (IsFieldSet(token, field_path)) {
-      return false;
+    for (int i = 0; i < any_of.size() && !found; ++i) {
+      found = (presence[i] & any_of[i]) != 0;
     }
+    if (!found) return false;
   }
   return true;
 }
 
 bool StyleSerializer::Serialize(const Token &token,
+                                const FieldPresence::Bits &presence,
+                                FieldTrie::Messages *messages,
                                 MutableTransducer *serialization) const {
-  if (!CheckRequiredFields(token) || !CheckProhibitedFields(token)) {
-    return false;
-  }
+  if (!CheckFields(presence)) return false;
   for (const auto &record_serializer : record_serializers_) {
-    if (!record_serializer->Serialize(token, serialization)) {
+    if (!record_serializer->Serialize(messages, serialization)) {
       LOG(ERROR) << "Record serialization failure for token " + token.name();
       return false;
     }
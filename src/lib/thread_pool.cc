@@ -0,0 +1,115 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+#include <sparrowhawk/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace speech {
+namespace sparrowhawk {
+
+namespace {
+
+// Bookkeeping shared between the caller of ParallelFor() and the helper tasks
+// it schedules. Helpers may outlive the call, so this is reference counted.
+struct ParallelForState {
+  explicit ParallelForState(int n) : size(n), next(0), done(0) {}
+  const int size;
+  std::atomic<int> next;
+  int done;
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+// Claims and runs indices until there are none left.
+void RunParallelFor(ParallelForState *state,
+                    const std::function<void(int)> *fn) {
+  int finished = 0;
+  for (int i = state->next++; i < state->size; i = state->next++) {
+    (*fn)(i);
+    ++finished;
+  }
+  if (finished > 0) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->done += finished;
+    if (state->done == state->size) state->condition.notify_all();
+  }
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) : stopping_(false) {
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (auto &worker : workers_) worker.join();
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)> &fn) {
+  if (n <= 0) return;
+  std::shared_ptr<ParallelForState> state(new ParallelForState(n));
+  // The caller is one of the workers, so at most n - 1 helpers are useful.
+  const int helpers = std::min(num_threads(), n - 1);
+  const std::function<void(int)> *fn_ptr = &fn;
+  for (int i = 0; i < helpers; ++i) {
+    // The helper only dereferences fn_ptr after claiming an index, which
+    // cannot happen once this call has returned.
+    Schedule([state, fn_ptr]() { RunParallelFor(state.get(), fn_ptr); });
+  }
+  RunParallelFor(state.get(), fn_ptr);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->condition.wait(lock, [&state]() {
+    return state->done == state->size;
+  });
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() {
+        return stopping_ || !tasks_.empty();
+      });
+      if (tasks_.empty()) return;  // Stopping, and nothing left to do.
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace sparrowhawk
+}  // namespace speech
@@ -0,0 +1,563 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright 2015 and onwards Google, Inc.
+// A protoc plugin that generates the MessageFields (see
+// include/sparrowhawk/message_fields.h) of the message types in a .proto file,
+// so that ProtobufParser and ProtobufSerializer can get at their fields without
+// reflection. For foo.proto, it writes foo.fields.h, which declares
+// RegisterFooMessageFields(), and foo.fields.cc, which defines it. Run as
+//
+//   protoc --plugin=protoc-gen-sparrowhawk=./protoc-gen-sparrowhawk
+//       --sparrowhawk_out=. foo.proto
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <sstream>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/compiler/plugin.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+
+namespace speech {
+namespace sparrowhawk {
+
+using google::protobuf::Descriptor;
+using google::protobuf::EnumDescriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::FileDescriptor;
+using google::protobuf::compiler::CodeGenerator;
+using google::protobuf::compiler::GeneratorContext;
+
+namespace {
+
+// Names that protoc gives a trailing underscore when they are used as field
+// names, because they are C++ keywords.
+const char *kKeywords[] = {
+  "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+  "bool", "break", "case", "catch", "char", "class", "compl", "const",
+  "constexpr", "const_cast", "continue", "decltype", "default", "delete", "do",
+  "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+  "false", "float", "for", "friend", "goto", "if", "inline", "int", "long",
+  "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr",
+  "operator", "or", "or_eq", "private", "protected", "public", "register",
+  "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+  "static_assert", "static_cast", "struct", "switch", "template", "this",
+  "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+  "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t",
+  "while", "xor", "xor_eq",
+};
+
+// Returns the file name without its directory or .proto extension.
+string BaseName(const FileDescriptor *file) {
+  string name = file->name();
+  const size_t slash = name.rfind('/');
+  if (slash != string::npos) name.erase(0, slash + 1);
+  const size_t dot = name.rfind(".proto");
+  if (dot != string::npos) name.erase(dot);
+  return name;
+}
+
+// Turns foo_bar into FooBar.
+string CamelCase(const string &name) {
+  string result;
+  bool capitalize = true;
+  for (char c : name) {
+    if (c == '_' || c == '-' || c == '.') {
+      capitalize = true;
+    } else if (capitalize) {
+      result.push_back(toupper(c));
+      capitalize = false;
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+string Namespace(const FileDescriptor *file) {
+  string result;
+  for (char c : file->package()) {
+    if (c == '.') {
+      result += "::";
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+// The C++ class names protoc gives nested types, such as Outer_Inner.
+string ClassName(const Descriptor *descriptor) {
+  if (descriptor->containing_type() == NULL) return descriptor->name();
+  return ClassName(descriptor->containing_type()) + "_" + descriptor->name();
+}
+
+string QualifiedClassName(const Descriptor *descriptor) {
+  return "::" + Namespace(descriptor->file()) + "::" + ClassName(descriptor);
+}
+
+string QualifiedEnumName(const EnumDescriptor *descriptor) {
+  string name = descriptor->name();
+  if (descriptor->containing_type() != NULL) {
+    name = ClassName(descriptor->containing_type()) + "_" + name;
+  }
+  return "::" + Namespace(descriptor->file()) + "::" + name;
+}
+
+// The name of the generated accessors of a field.
+string AccessorName(const FieldDescriptor *field) {
+  string name = field->name();
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  for (const char *keyword : kKeywords) {
+    if (name == keyword) return name + "_";
+  }
+  return name;
+}
+
+// The C++ type of a scalar field as ParseFieldValue() and AppendFieldValue()
+// take it, or the empty string for enums, strings and messages.
+string ScalarType(const FieldDescriptor *field) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return "bool";
+    case FieldDescriptor::CPPTYPE_INT32:
+      return "int32";
+    case FieldDescriptor::CPPTYPE_INT64:
+      return "int64";
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return "uint32";
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return "uint64";
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return "float";
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return "double";
+    default:
+      return "";
+  }
+}
+
+// The expression for the value of a field in the generated code, where the
+// message is m and the value index.
+string GetValue(const FieldDescriptor *field) {
+  return "m." + AccessorName(field) + (field->is_repeated() ? "(index)" : "()");
+}
+
+// The statement that sets, or adds, a field to value.
+string SetValue(const FieldDescriptor *field, const string &value) {
+  return "m->" + string(field->is_repeated() ? "add_" : "set_") +
+      AccessorName(field) + "(" + value + ");";
+}
+
+// Fields in field number order.
+std::vector<const FieldDescriptor *> FieldsByNumber(
+    const Descriptor *descriptor) {
+  std::vector<const FieldDescriptor *> fields;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    fields.push_back(descriptor->field(i));
+  }
+  std::sort(fields.begin(), fields.end(),
+            [](const FieldDescriptor *a, const FieldDescriptor *b) {
+              return a->number() < b->number();
+            });
+  return fields;
+}
+
+void AddMessageTypes(const Descriptor *descriptor,
+                     std::vector<const Descriptor *> *descriptors) {
+  // Map entries are not real messages with generated classes of their own.
+  if (descriptor->options().map_entry()) return;
+  descriptors->push_back(descriptor);
+  for (int i = 0; i < descriptor->nested_type_count(); ++i) {
+    AddMessageTypes(descriptor->nested_type(i), descriptors);
+  }
+}
+
+void GenerateFindFieldByName(const Descriptor *descriptor,
+                             std::ostringstream *out) {
+  const string class_name = QualifiedClassName(descriptor);
+  *out << "  const FieldDescriptor *FindFieldByName(\n"
+       << "      const string &name) const override {\n";
+  if (descriptor->field_count() == 0) {
+    *out << "    return NULL;\n"
+         << "  }\n\n";
+    return;
+  }
+  std::vector<std::pair<string, int>> names;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    names.push_back(std::make_pair(descriptor->field(i)->name(), i));
+  }
+  std::sort(names.begin(), names.end());
+  *out << "    static const FieldName kNames[] = {\n";
+  for (const auto &name : names) {
+    *out << "      {\"" << name.first << "\", " << name.second << "},\n";
+  }
+  *out << "    };\n"
+       << "    const int index =\n"
+       << "        FindFieldIndex(kNames, " << names.size() << ", name);\n"
+       << "    return index < 0 ? NULL : " << class_name
+       << "::descriptor()->field(index);\n"
+       << "  }\n\n";
+}
+
+void GenerateListFields(const Descriptor *descriptor,
+                        std::ostringstream *out) {
+  const string class_name = QualifiedClassName(descriptor);
+  *out << "  void ListFields(\n"
+       << "      const Message &message,\n"
+       << "      std::vector<const FieldDescriptor *> *fields) const override {\n";
+  if (descriptor->extension_range_count() > 0) {
+    // There is no generated way to find the extensions that are set.
+    *out << "    message.GetReflection()->ListFields(message, fields);\n"
+         << "  }\n\n";
+    return;
+  }
+  if (descriptor->field_count() == 0) {
+    *out << "  }\n\n";
+    return;
+  }
+  *out << "    const " << class_name << " &m =\n"
+       << "        static_cast<const " << class_name << " &>(message);\n"
+       << "    const google::protobuf::Descriptor *descriptor = " << class_name
+       << "::descriptor();\n";
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    const string name = AccessorName(field);
+    if (field->is_repeated()) {
+      *out << "    if (m." << name << "_size() > 0) {\n";
+    } else {
+      *out << "    if (m.has_" << name << "()) {\n";
+    }
+    *out << "      fields->push_back(descriptor->field(" << field->index()
+         << "));\n"
+         << "    }\n";
+  }
+  *out << "  }\n\n";
+}
+
+// Writes the body of a method that switches on the field number, given the
+// cases, or just the fallback if there are none. The fallback is given as
+// lines without indentation. When mutable_message is set, the message is
+// cast to a pointer rather than a reference.
+void GenerateSwitch(const Descriptor *descriptor,
+                    bool mutable_message,
+                    const string &cases,
+                    const std::vector<string> &fallback,
+                    std::ostringstream *out) {
+  const string class_name = QualifiedClassName(descriptor);
+  string indent = "    ";
+  if (!cases.empty()) {
+    if (mutable_message) {
+      *out << "    " << class_name << " *m = static_cast<" << class_name
+           << " *>(message);\n";
+    } else {
+      *out << "    const " << class_name << " &m =\n"
+           << "        static_cast<const " << class_name << " &>(message);\n";
+    }
+    *out << "    switch (field->number()) {\n"
+         << cases
+         << "      default:\n";
+    indent = "        ";
+  }
+  for (const string &line : fallback) *out << indent << line << "\n";
+  if (!cases.empty()) *out << "    }\n";
+  *out << "  }\n\n";
+}
+
+void GenerateFieldSize(const Descriptor *descriptor, std::ostringstream *out) {
+  std::ostringstream cases;
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    if (!field->is_repeated()) continue;
+    cases << "      case " << field->number() << ":\n"
+          << "        return m." << AccessorName(field) << "_size();\n";
+  }
+  *out << "  int FieldSize(const Message &message,\n"
+       << "                const FieldDescriptor *field) const override {\n";
+  GenerateSwitch(descriptor, false, cases.str(),
+                 {"return message.GetReflection()->FieldSize(message, field);"},
+                 out);
+}
+
+void GenerateGetMessage(const Descriptor *descriptor,
+                        std::ostringstream *out) {
+  std::ostringstream cases;
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) continue;
+    cases << "      case " << field->number() << ":\n"
+          << "        return " << GetValue(field) << ";\n";
+  }
+  *out << "  const Message &GetMessage(const Message &message,\n"
+       << "                            const FieldDescriptor *field,\n"
+       << "                            int index) const override {\n";
+  GenerateSwitch(
+      descriptor, false, cases.str(),
+      {"return field->is_repeated() ?",
+       "    message.GetReflection()->GetRepeatedMessage(message, field,",
+       "                                                index) :",
+       "    message.GetReflection()->GetMessage(message, field);"},
+      out);
+}
+
+void GenerateGetString(const Descriptor *descriptor, std::ostringstream *out) {
+  std::ostringstream cases;
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    if (field->cpp_type() != FieldDescriptor::CPPTYPE_STRING) continue;
+    cases << "      case " << field->number() << ":\n"
+          << "        return " << GetValue(field) << ";\n";
+  }
+  *out << "  const string &GetString(const Message &message,\n"
+       << "                          const FieldDescriptor *field,\n"
+       << "                          int index,\n"
+       << "                          string *scratch) const override {\n";
+  GenerateSwitch(
+      descriptor, false, cases.str(),
+      {"return field->is_repeated() ?",
+       "    message.GetReflection()->GetRepeatedStringReference(",
+       "        message, field, index, scratch) :",
+       "    message.GetReflection()->GetStringReference(",
+       "        message, field, scratch);"},
+      out);
+}
+
+void GenerateAppendValue(const Descriptor *descriptor,
+                         std::ostringstream *out) {
+  std::ostringstream cases;
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+      cases << "      case " << field->number() << ":\n"
+            << "        text->append(" << QualifiedEnumName(field->enum_type())
+            << "_Name(\n"
+            << "            " << GetValue(field) << "));\n"
+            << "        return true;\n";
+      continue;
+    }
+    const string type = ScalarType(field);
+    if (type.empty() || type == "float" || type == "double") continue;
+    cases << "      case " << field->number() << ":\n"
+          << "        AppendFieldValue(static_cast<" << type << ">("
+          << GetValue(field) << "), text);\n"
+          << "        return true;\n";
+  }
+  *out << "  bool AppendValue(const Message &message,\n"
+       << "                   const FieldDescriptor *field,\n"
+       << "                   int index,\n"
+       << "                   string *text) const override {\n";
+  GenerateSwitch(descriptor, false, cases.str(), {"return false;"}, out);
+}
+
+void GenerateMutableMessage(const Descriptor *descriptor,
+                            std::ostringstream *out) {
+  std::ostringstream cases;
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) continue;
+    cases << "      case " << field->number() << ":\n"
+          << "        return m->" << (field->is_repeated() ? "add_" : "mutable_")
+          << AccessorName(field) << "();\n";
+  }
+  *out << "  Message *MutableMessage(\n"
+       << "      Message *message,\n"
+       << "      const FieldDescriptor *field) const override {\n";
+  GenerateSwitch(
+      descriptor, true, cases.str(),
+      {"return field->is_repeated() ?",
+       "    message->GetReflection()->AddMessage(message, field) :",
+       "    message->GetReflection()->MutableMessage(message, field);"},
+      out);
+}
+
+void GenerateSetFieldFromString(const Descriptor *descriptor,
+                                std::ostringstream *out) {
+  std::ostringstream cases;
+  for (const FieldDescriptor *field : FieldsByNumber(descriptor)) {
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        continue;
+      case FieldDescriptor::CPPTYPE_STRING:
+        cases << "      case " << field->number() << ":\n"
+              << "        " << SetValue(field, "value") << "\n"
+              << "        return true;\n";
+        break;
+      case FieldDescriptor::CPPTYPE_ENUM: {
+        const string enum_name = QualifiedEnumName(field->enum_type());
+        cases << "      case " << field->number() << ": {\n"
+              << "        " << enum_name << " parsed;\n"
+              << "        if (" << enum_name << "_Parse(value, &parsed)) {\n"
+              << "          " << SetValue(field, "parsed") << "\n"
+              << "        } else {\n"
+              << "          LoggerError(\"Unknown enumeration value %s\", "
+              << "value.c_str());\n"
+              << "        }\n"
+              << "        return true;\n"
+              << "      }\n";
+        break;
+      }
+      default:
+        cases << "      case " << field->number() << ": {\n"
+              << "        " << ScalarType(field) << " parsed;\n"
+              << "        if (ParseFieldValue(value, &parsed)) {\n"
+              << "          " << SetValue(field, "parsed") << "\n"
+              << "        }\n"
+              << "        return true;\n"
+              << "      }\n";
+        break;
+    }
+  }
+  *out << "  bool SetFieldFromString(Message *message,\n"
+       << "                          const FieldDescriptor *field,\n"
+       << "                          const string &value) const override {\n";
+  GenerateSwitch(descriptor, true, cases.str(), {"return false;"}, out);
+}
+
+void GenerateMessageFields(const Descriptor *descriptor,
+                           std::ostringstream *out) {
+  *out << "class " << ClassName(descriptor) << "Fields : public MessageFields "
+       << "{\n"
+       << " public:\n";
+  GenerateFindFieldByName(descriptor, out);
+  GenerateListFields(descriptor, out);
+  GenerateFieldSize(descriptor, out);
+  GenerateGetMessage(descriptor, out);
+  GenerateGetString(descriptor, out);
+  GenerateAppendValue(descriptor, out);
+  GenerateMutableMessage(descriptor, out);
+  GenerateSetFieldFromString(descriptor, out);
+  *out << "};\n\n";
+}
+
+void OpenNamespace(const FileDescriptor *file, std::ostringstream *out) {
+  std::istringstream package(file->package());
+  string part;
+  while (std::getline(package, part, '.')) {
+    *out << "namespace " << part << " {\n";
+  }
+}
+
+void CloseNamespace(const FileDescriptor *file, std::ostringstream *out) {
+  std::vector<string> parts;
+  std::istringstream package(file->package());
+  string part;
+  while (std::getline(package, part, '.')) parts.push_back(part);
+  for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+    *out << "}  // namespace " << *it << "\n";
+  }
+}
+
+bool WriteFile(GeneratorContext *context, const string &filename,
+               const string &contents) {
+  std::unique_ptr<google::protobuf::io::ZeroCopyOutputStream> output(
+      context->Open(filename));
+  google::protobuf::io::Printer printer(output.get(), '$');
+  printer.PrintRaw(contents);
+  return !printer.failed();
+}
+
+}  // namespace
+
+class SparrowhawkGenerator : public CodeGenerator {
+ public:
+  SparrowhawkGenerator() { }
+
+  bool Generate(const FileDescriptor *file,
+                const string &parameter,
+                GeneratorContext *context,
+                string *error) const override {
+    const string base_name = BaseName(file);
+    const string register_function =
+        "Register" + CamelCase(base_name) + "MessageFields";
+    string guard = "SPARROWHAWK_" + base_name + "_FIELDS_H_";
+    std::transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+    std::replace(guard.begin(), guard.end(), '-', '_');
+
+    std::ostringstream header;
+    header << "// Generated by protoc-gen-sparrowhawk from " << file->name()
+           << ". DO NOT EDIT.\n\n"
+           << "#ifndef " << guard << "\n"
+           << "#define " << guard << "\n\n";
+    OpenNamespace(file, &header);
+    header << "\n"
+           << "// Registers the MessageFields of the message types in "
+           << file->name() << ".\n"
+           << "void " << register_function << "();\n\n";
+    CloseNamespace(file, &header);
+    header << "\n#endif  // " << guard << "\n";
+
+    std::vector<const Descriptor *> descriptors;
+    for (int i = 0; i < file->message_type_count(); ++i) {
+      AddMessageTypes(file->message_type(i), &descriptors);
+    }
+    std::ostringstream source;
+    source << "// Generated by protoc-gen-sparrowhawk from " << file->name()
+           << ". DO NOT EDIT.\n\n"
+           << "#include <sparrowhawk/" << base_name << ".fields.h>\n\n"
+           << "#include <cstdio>\n"
+           << "#include <string>\n"
+           << "using std::string;\n"
+           << "#include <vector>\n"
+           << "using std::vector;\n\n"
+           << "#include <google/protobuf/descriptor.h>\n"
+           << "#include <google/protobuf/message.h>\n"
+           << "#include <sparrowhawk/" << base_name << ".pb.h>\n"
+           << "#include <sparrowhawk/logger.h>\n"
+           << "#include <sparrowhawk/message_fields.h>\n\n"
+           << "// Deprecated fields are still parsed and serialized.\n"
+           << "#pragma GCC diagnostic ignored \"-Wdeprecated-declarations\"\n\n";
+    OpenNamespace(file, &source);
+    source << "\n"
+           << "namespace {\n\n"
+           << "using ::speech::sparrowhawk::AppendFieldValue;\n"
+           << "using ::speech::sparrowhawk::FieldName;\n"
+           << "using ::speech::sparrowhawk::FindFieldIndex;\n"
+           << "using ::speech::sparrowhawk::MessageFields;\n"
+           << "using ::speech::sparrowhawk::ParseFieldValue;\n\n"
+           << "typedef google::protobuf::FieldDescriptor FieldDescriptor;\n"
+           << "typedef google::protobuf::Message Message;\n\n";
+    for (const Descriptor *descriptor : descriptors) {
+      GenerateMessageFields(descriptor, &source);
+    }
+    source << "}  // namespace\n\n"
+           << "void " << register_function << "() {\n";
+    for (const Descriptor *descriptor : descriptors) {
+      source << "  ::speech::sparrowhawk::RegisterMessageFields(\n"
+             << "      " << QualifiedClassName(descriptor) << "::descriptor(),\n"
+             << "      new " << ClassName(descriptor) << "Fields);\n";
+    }
+    source << "}\n\n";
+    CloseNamespace(file, &source);
+
+    if (!WriteFile(context, base_name + ".fields.h", header.str()) ||
+        !WriteFile(context, base_name + ".fields.cc", source.str())) {
+      *error = "Failed to write the output for " + file->name();
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  SparrowhawkGenerator(const SparrowhawkGenerator &) = delete;
+  SparrowhawkGenerator &operator=(const SparrowhawkGenerator &) = delete;
+};
+
+}  // namespace sparrowhawk
+}  // namespace speech
+
+int main(int argc, char **argv) {
+  speech::sparrowhawk::SparrowhawkGenerator generator;
+  return google::protobuf::compiler::PluginMain(argc, argv, &generator);
+}